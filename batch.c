@@ -0,0 +1,315 @@
+// Runs many programs at once on a work-stealing pool of threads.
+// Created by Jackson Eshbaugh on 16.10.2026.
+
+#include "batch.h"
+#include "sim.h"
+#include "memory.h"
+#include "controller.h"
+#include "snapshot.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define LINE_SIZE 1024
+
+/**
+ * One program to run, and where to log its final state.
+ */
+typedef struct {
+    char *binary;
+    char *log;
+    unsigned short sp;
+    unsigned short pc;
+} BatchJob;
+
+/**
+ * The jobs a worker has yet to run. The owner takes jobs from the bottom; thieves take
+ * them from the top, so the two only meet over the last job.
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    int *jobs; // indices into the batch's job list
+    int top;
+    int bottom;
+} JobQueue;
+
+typedef struct Batch Batch;
+
+typedef struct {
+    Batch *batch;
+    int id;
+    JobQueue queue;
+    int failures;
+    int stopped; // jobs a limit stopped before they halted
+    SsamVm *vm;
+    VmSnapshot *start; // the VM just after loading startJob, to rerun it without reloading
+    const BatchJob *startJob;
+} BatchWorker;
+
+struct Batch {
+    BatchJob *jobs;
+    int jobCount;
+    BatchWorker *workers;
+    int workerCount;
+    RunLimits limits; // on each job's run
+};
+
+/**
+ * Takes the next job from a worker's own queue.
+ * @param queue the worker's queue
+ * @return the job's index, or -1 if the queue is empty
+ */
+int popJob(JobQueue *queue) {
+    int job = -1;
+    pthread_mutex_lock(&queue->lock);
+    if (queue->bottom > queue->top) job = queue->jobs[--queue->bottom];
+    pthread_mutex_unlock(&queue->lock);
+    return job;
+}
+
+/**
+ * Takes the oldest job from another worker's queue.
+ * @param queue the queue to steal from
+ * @return the job's index, or -1 if the queue is empty
+ */
+int stealJob(JobQueue *queue) {
+    int job = -1;
+    pthread_mutex_lock(&queue->lock);
+    if (queue->bottom > queue->top) job = queue->jobs[queue->top++];
+    pthread_mutex_unlock(&queue->lock);
+    return job;
+}
+
+/**
+ * Loads a job's program into the worker's VM and snapshots it, unless the worker's last
+ * job ran the same program from the same start, in which case the snapshot is restored;
+ * that only copies back the pages the last run wrote.
+ * @param worker the worker
+ * @param job the job to load
+ * @return 0 on success, 1 if the binary couldn't be loaded
+ */
+int loadJob(BatchWorker *worker, const BatchJob *job) {
+    SsamVm *vm = worker->vm;
+    const BatchJob *last = worker->startJob;
+    if (last && last->sp == job->sp && last->pc == job->pc && strcmp(last->binary, job->binary) == 0) {
+        restoreSnapshot(vm, worker->start);
+        return 0;
+    }
+
+    FILE *binary = fopen(job->binary, "rb");
+    if (!binary) {
+        fprintf(stderr, "Error: specified binary file \"%s\" could not be loaded.\n", job->binary);
+        return 1;
+    }
+
+    if (worker->start) destroySnapshot(vm, worker->start);
+    worker->start = NULL;
+    worker->startJob = NULL;
+    resetVm(vm);
+    controllerInit(vm, job->sp, job->pc);
+    int programSize = loadProgram(vm, binary);
+    fclose(binary);
+    if (programSize < 0) {
+        fprintf(stderr, "Error: specified binary file \"%s\" could not be loaded.\n", job->binary);
+        return 1;
+    }
+    if (programSize > job->pc) predecode(vm, job->pc, programSize);
+
+    worker->start = takeSnapshot(vm);
+    if (worker->start) worker->startJob = job;
+    return 0;
+}
+
+/**
+ * Loads a job's program, runs it until it halts or a limit stops it, and logs its final
+ * state.
+ * @param worker the worker to run the job on
+ * @param job the job to run
+ * @return 0 on success, 1 if the binary couldn't be loaded or the log couldn't be opened
+ */
+int runJob(BatchWorker *worker, const BatchJob *job) {
+    SsamVm *vm = worker->vm;
+    if (loadJob(worker, job)) return 1;
+
+    // Errors don't stop the machine, so keep going past them (like H does).
+    RunStatus status = runLimited(vm, &worker->batch->limits);
+    if (status != RUN_HALTED) {
+        fprintf(stderr, "Stopped %s: %s.\n", job->binary,
+                status == RUN_TIMEOUT ? "it ran for the whole timeout" : "it ran its whole budget");
+        worker->stopped++;
+    }
+
+    FILE *log = fopen(job->log, "w");
+    if (!log) {
+        fprintf(stderr, "Error: %s could not be opened.\n", job->log);
+        return 1;
+    }
+    logState(vm, log, job->sp - 0x02, job->pc);
+    fclose(log);
+    return 0;
+}
+
+/**
+ * The body of each worker thread: drains its own queue, then steals from the others
+ * until every queue is empty. Jobs are never added once the batch starts, so finding
+ * every queue empty means the worker is done.
+ * @param arg the worker
+ * @return NULL
+ */
+void *batchWorker(void *arg) {
+    BatchWorker *worker = arg;
+    Batch *batch = worker->batch;
+
+    worker->vm = createVm();
+    if (!worker->vm) {
+        fprintf(stderr, "Error: could not allocate the VM.\n");
+        worker->failures++;
+        return NULL;
+    }
+
+    while (1) {
+        int job = popJob(&worker->queue);
+        for (int i = 1; job < 0 && i < batch->workerCount; i++) {
+            job = stealJob(&batch->workers[(worker->id + i) % batch->workerCount].queue);
+        }
+        if (job < 0) break;
+        worker->failures += runJob(worker, &batch->jobs[job]);
+    }
+
+    if (worker->start) destroySnapshot(worker->vm, worker->start);
+    destroyVm(worker->vm);
+    return NULL;
+}
+
+/**
+ * Reads every job from a manifest.
+ * @param manifest the open manifest
+ * @param batch the batch to add the jobs to
+ * @return 0 on success, 1 if the manifest is malformed or memory ran out
+ */
+int readManifest(FILE *manifest, Batch *batch) {
+    char line[LINE_SIZE];
+    char binary[LINE_SIZE], log[LINE_SIZE];
+    int capacity = 0, lineNumber = 0;
+
+    while (fgets(line, LINE_SIZE, manifest)) {
+        lineNumber++;
+        unsigned short sp, pc;
+        char first[2];
+        if (sscanf(line, "%1s", first) != 1 || first[0] == '#') continue;
+
+        int fields = sscanf(line, "%1023s %hx %hx %1023s", binary, &sp, &pc, log);
+        if (fields < 3) {
+            fprintf(stderr, "Error: line %d of the manifest should be \"<file.bin> <0xbp> <0xpc> [log file]\".\n", lineNumber);
+            return 1;
+        }
+        if (fields == 3) snprintf(log, LINE_SIZE, "%.1018s.log", binary);
+
+        if (batch->jobCount == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            BatchJob *jobs = realloc(batch->jobs, capacity * sizeof(BatchJob));
+            if (!jobs) return 1;
+            batch->jobs = jobs;
+        }
+        BatchJob *job = &batch->jobs[batch->jobCount++];
+        job->binary = strdup(binary);
+        job->log = strdup(log);
+        job->sp = sp;
+        job->pc = pc;
+        if (!job->binary || !job->log) return 1;
+    }
+    return 0;
+}
+
+/**
+ * Frees the jobs and workers of a batch.
+ * @param batch the batch
+ */
+void freeBatch(Batch *batch) {
+    for (int i = 0; i < batch->jobCount; i++) {
+        free(batch->jobs[i].binary);
+        free(batch->jobs[i].log);
+    }
+    free(batch->jobs);
+    if (batch->workers) {
+        for (int i = 0; i < batch->workerCount; i++) {
+            pthread_mutex_destroy(&batch->workers[i].queue.lock);
+            free(batch->workers[i].queue.jobs);
+        }
+        free(batch->workers);
+    }
+}
+
+int runBatch(const char *manifestPath, int threadCount, const RunLimits *limits) {
+    FILE *manifest = fopen(manifestPath, "r");
+    if (!manifest) {
+        fprintf(stderr, "Error: manifest \"%s\" could not be opened.\n", manifestPath);
+        return 1;
+    }
+
+    Batch batch = {0};
+    batch.limits = *limits;
+    int failed = readManifest(manifest, &batch);
+    fclose(manifest);
+    if (failed || batch.jobCount == 0) {
+        if (!failed) fprintf(stderr, "Error: manifest \"%s\" lists no jobs.\n", manifestPath);
+        freeBatch(&batch);
+        return 1;
+    }
+
+    if (threadCount <= 0) threadCount = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if (threadCount <= 0) threadCount = 1;
+    if (threadCount > batch.jobCount) threadCount = batch.jobCount;
+
+    // Deal the jobs out round-robin so every worker starts with a share
+    batch.workerCount = threadCount;
+    batch.workers = calloc(threadCount, sizeof(BatchWorker));
+    if (!batch.workers) {
+        freeBatch(&batch);
+        return 1;
+    }
+    for (int i = 0; i < threadCount; i++) {
+        BatchWorker *worker = &batch.workers[i];
+        worker->batch = &batch;
+        worker->id = i;
+        pthread_mutex_init(&worker->queue.lock, NULL);
+        worker->queue.jobs = malloc((batch.jobCount / threadCount + 1) * sizeof(int));
+        if (!worker->queue.jobs) failed = 1;
+    }
+    if (failed) {
+        freeBatch(&batch);
+        return 1;
+    }
+    for (int job = batch.jobCount - 1; job >= 0; job--) {
+        // Pushed in reverse, so each worker runs its share in manifest order
+        JobQueue *queue = &batch.workers[job % threadCount].queue;
+        queue->jobs[queue->bottom++] = job;
+    }
+
+    pthread_t *threads = malloc(threadCount * sizeof(pthread_t));
+    if (!threads) {
+        freeBatch(&batch);
+        return 1;
+    }
+    int started = 0;
+    for (; started < threadCount; started++) {
+        if (pthread_create(&threads[started], NULL, batchWorker, &batch.workers[started])) break;
+    }
+    if (started == 0) batchWorker(&batch.workers[0]); // no threads; run everything here
+
+    int failures = 0, stopped = 0;
+    for (int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+    for (int i = 0; i < threadCount; i++) {
+        failures += batch.workers[i].failures;
+        stopped += batch.workers[i].stopped;
+    }
+    free(threads);
+
+    printf("Ran %d jobs on %d threads; %d failed", batch.jobCount, started ? started : 1, failures);
+    if (stopped) printf(", and a limit stopped %d", stopped);
+    printf(".\n");
+    freeBatch(&batch);
+    return failures || stopped ? 1 : 0;
+}
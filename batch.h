@@ -0,0 +1,33 @@
+// Runs many programs at once on a work-stealing pool of threads.
+// Created by Jackson Eshbaugh on 16.10.2026.
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "controller.h"
+
+/**
+ * Runs every job listed in a manifest until it halts or a limit stops it, then logs its
+ * final state like the Q command does. Each line of the manifest names one job:
+ *
+ *     <file.bin> <0xinitial-base-pointer> <0xinitial-program-counter> [log file]
+ *
+ * Blank lines and lines starting with '#' are skipped. If no log file is given, the state
+ * is written to "<file.bin>.log". Jobs are dealt out evenly to the threads up front; a
+ * thread that runs out of jobs steals from the others, so one slow program doesn't hold
+ * up the rest of the batch. Each thread runs its jobs on its own VM; when a thread runs
+ * the same program twice in a row, it restores a snapshot instead of reloading it.
+ *
+ * A job that a limit stops is logged with the limit in its state (see runLimited() in
+ * controller.h), reported, and counted as stopped, so a program that never halts can't
+ * hold a thread forever.
+ *
+ * @param manifestPath the path to the manifest
+ * @param threadCount the number of threads to run, or 0 for one per online core
+ * @param limits the limits on each job's run
+ * @return 0 if every job halted, 1 if the manifest couldn't be read or any job failed or
+ *         was stopped by a limit
+ */
+int runBatch(const char *manifestPath, int threadCount, const RunLimits *limits);
+
+#endif //BATCH_H
@@ -0,0 +1,285 @@
+// Breakpoints: stop a run before the instruction at an address, optionally only when a
+// condition on the registers and memory holds.
+// Created by Jackson Eshbaugh on 16.10.2026.
+
+#include "breakpoint.h"
+#include "controller.h"
+#include "memory.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * A condition being compiled.
+ */
+typedef struct {
+    const char *text; // what is left to parse
+    unsigned char *code;
+    int length;
+    const char *error; // set once something goes wrong
+} BreakCompiler;
+
+/**
+ * Appends bytes to the compiled condition.
+ * @param compiler the compiler
+ * @param op the opcode
+ * @param operand the operand, if any
+ * @param operandSize the size of the operand: 0, 1 (a register) or 2 (a word)
+ */
+void emitBreakOp(BreakCompiler *compiler, BreakOp op, unsigned short operand, int operandSize) {
+    if (compiler->length + 1 + operandSize > BREAK_CODE_MAX - 1) { // leave room for BREAK_END
+        if (!compiler->error) compiler->error = "the condition is too long";
+        return;
+    }
+    compiler->code[compiler->length++] = op;
+    if (operandSize == 1) compiler->code[compiler->length++] = operand;
+    if (operandSize == 2) {
+        compiler->code[compiler->length++] = operand >> 8;
+        compiler->code[compiler->length++] = operand & 0xFF;
+    }
+}
+
+/**
+ * Skips spaces, then consumes token if the text continues with it.
+ * @param compiler the compiler
+ * @param token the token to look for
+ * @return 1 if it was there, 0 if not
+ */
+int acceptToken(BreakCompiler *compiler, const char *token) {
+    while (*compiler->text == ' ') compiler->text++;
+    size_t length = strlen(token);
+    if (strncmp(compiler->text, token, length) != 0) return 0;
+    compiler->text += length;
+    return 1;
+}
+
+/**
+ * Consumes a register name (R0-R3, AC, SP, BP, PC or IR, in either case).
+ * @param compiler the compiler
+ * @return the register, or -1 if the text doesn't continue with one
+ */
+int acceptRegister(BreakCompiler *compiler) {
+    const char *names[] = {"R0", "R1", "R2", "R3", "AC", "SP", "BP", "PC", "IR"};
+    while (*compiler->text == ' ') compiler->text++;
+    for (int r = 0; r < REG_COUNT; r++) {
+        if (toupper((unsigned char) compiler->text[0]) == names[r][0] &&
+            toupper((unsigned char) compiler->text[1]) == names[r][1] &&
+            !isalnum((unsigned char) compiler->text[2])) {
+            compiler->text += 2;
+            return r;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Consumes a number: decimal, or hex with 0x, either optionally negative.
+ * @param compiler the compiler
+ * @param value set to the number, as a 16-bit word
+ * @return 1 if the text continued with a number, 0 if not
+ */
+int acceptNumber(BreakCompiler *compiler, unsigned short *value) {
+    while (*compiler->text == ' ') compiler->text++;
+    const char *digits = compiler->text;
+    if (*digits == '-') digits++;
+    int base = digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X') ? 16 : 10;
+    char *end;
+    long number = strtol(compiler->text, &end, base);
+    if (end == compiler->text) return 0;
+    compiler->text = end;
+    *value = (unsigned short) number;
+    return 1;
+}
+
+/**
+ * Compiles an operand: a register, a word of memory, or a number.
+ * @param compiler the compiler
+ */
+void compileOperand(BreakCompiler *compiler) {
+    unsigned short value;
+    int reg = acceptRegister(compiler);
+    if (reg >= 0) {
+        emitBreakOp(compiler, BREAK_REGISTER, reg, 1);
+    } else if (acceptToken(compiler, "M[") || acceptToken(compiler, "m[")) {
+        reg = acceptRegister(compiler);
+        if (reg >= 0) emitBreakOp(compiler, BREAK_MEMORY_AT, reg, 1);
+        else if (acceptNumber(compiler, &value)) emitBreakOp(compiler, BREAK_MEMORY, value, 2);
+        else if (!compiler->error) compiler->error = "expected an address or register after M[";
+        if (!acceptToken(compiler, "]") && !compiler->error) compiler->error = "expected ] after the address";
+    } else if (acceptNumber(compiler, &value)) {
+        emitBreakOp(compiler, BREAK_CONSTANT, value, 2);
+    } else if (!compiler->error) {
+        compiler->error = "expected a register, M[...] or a number";
+    }
+}
+
+/**
+ * Compiles a comparison: an operand, a comparison operator, and another operand.
+ * @param compiler the compiler
+ */
+void compileComparison(BreakCompiler *compiler) {
+    // Two-character operators first, so "<=" isn't taken for "<"
+    const char *tokens[] = {"==", "!=", "<=", ">=", "<", ">"};
+    const BreakOp ops[] = {BREAK_EQ, BREAK_NE, BREAK_LE, BREAK_GE, BREAK_LT, BREAK_GT};
+
+    compileOperand(compiler);
+    for (int i = 0; i < 6; i++) {
+        if (acceptToken(compiler, tokens[i])) {
+            compileOperand(compiler);
+            emitBreakOp(compiler, ops[i], 0, 0);
+            return;
+        }
+    }
+    if (!compiler->error) compiler->error = "expected ==, !=, <, <=, > or >=";
+}
+
+/**
+ * Compiles comparisons joined by &&.
+ * @param compiler the compiler
+ */
+void compileAnd(BreakCompiler *compiler) {
+    compileComparison(compiler);
+    while (!compiler->error && acceptToken(compiler, "&&")) {
+        compileComparison(compiler);
+        emitBreakOp(compiler, BREAK_AND, 0, 0);
+    }
+}
+
+/**
+ * Compiles a whole condition: groups of &&-joined comparisons, joined by ||.
+ * @param compiler the compiler
+ */
+void compileOr(BreakCompiler *compiler) {
+    compileAnd(compiler);
+    while (!compiler->error && acceptToken(compiler, "||")) {
+        compileAnd(compiler);
+        emitBreakOp(compiler, BREAK_OR, 0, 0);
+    }
+}
+
+int addBreakpoint(SsamVm *vm, unsigned short address, const char *condition, const char **error) {
+    *error = NULL;
+    if (!vm->breaks) {
+        vm->breaks = calloc(1, sizeof(BreakList));
+        if (!vm->breaks) {
+            *error = "out of memory";
+            return 0;
+        }
+    }
+    BreakList *breaks = vm->breaks;
+    if (breaks->count == BREAK_MAX) {
+        *error = "too many breakpoints";
+        return 0;
+    }
+
+    Breakpoint *point = &breaks->points[breaks->count];
+    memset(point, 0, sizeof(Breakpoint));
+    point->address = address;
+    if (condition && *condition) {
+        BreakCompiler compiler = {condition, point->code, 0, NULL};
+        compileOr(&compiler);
+        while (*compiler.text == ' ') compiler.text++;
+        if (!compiler.error && *compiler.text) compiler.error = "unexpected text after the condition";
+        if (compiler.error) {
+            *error = compiler.error;
+            if (breaks->count == 0) clearBreakpoints(vm);
+            return 0;
+        }
+        point->code[compiler.length++] = BREAK_END;
+        point->length = compiler.length;
+        strncpy(point->text, condition, BREAK_TEXT_MAX - 1);
+    }
+    breaks->count++;
+
+    // The instruction there, and any superinstruction running into it, has to be decoded
+    // again to dispatch to OP_BREAK
+    breaks->map[address >> 3] |= 1 << (address & 7);
+    invalidateDecoded(vm, address);
+    return 1;
+}
+
+void clearBreakpoints(SsamVm *vm) {
+    BreakList *breaks = vm->breaks;
+    if (!breaks) return;
+    vm->breaks = NULL;
+    for (int i = 0; i < breaks->count; i++) invalidateDecoded(vm, breaks->points[i].address);
+    free(breaks);
+}
+
+/**
+ * Runs a compiled condition.
+ * @param vm the VM, for memory
+ * @param r the registers
+ * @param code the compiled condition
+ * @return 1 if it holds, 0 if not
+ */
+int conditionHolds(SsamVm *vm, const unsigned short *r, const unsigned char *code) {
+    short stack[BREAK_STACK_MAX];
+    int top = 0;
+    for (;;) {
+        BreakOp op = *code++;
+        switch (op) {
+            case BREAK_END:
+                return stack[top - 1] != 0;
+            case BREAK_REGISTER:
+                stack[top++] = r[*code++];
+                continue;
+            case BREAK_MEMORY:
+                stack[top++] = getWord(vm, code[0] << 8 | code[1]);
+                code += 2;
+                continue;
+            case BREAK_MEMORY_AT:
+                stack[top++] = getWord(vm, r[*code++]);
+                continue;
+            case BREAK_CONSTANT:
+                stack[top++] = code[0] << 8 | code[1];
+                code += 2;
+                continue;
+            default:
+                break;
+        }
+
+        // The rest pop two values and push one
+        short right = stack[--top];
+        short left = stack[top - 1];
+        switch (op) {
+            case BREAK_EQ:
+                stack[top - 1] = left == right;
+                break;
+            case BREAK_NE:
+                stack[top - 1] = left != right;
+                break;
+            case BREAK_LT:
+                stack[top - 1] = left < right;
+                break;
+            case BREAK_LE:
+                stack[top - 1] = left <= right;
+                break;
+            case BREAK_GT:
+                stack[top - 1] = left > right;
+                break;
+            case BREAK_GE:
+                stack[top - 1] = left >= right;
+                break;
+            case BREAK_AND:
+                stack[top - 1] = left && right;
+                break;
+            default:
+                stack[top - 1] = left || right;
+                break;
+        }
+    }
+}
+
+int breakpointHit(SsamVm *vm, const unsigned short *r, unsigned short address) {
+    BreakList *breaks = vm->breaks;
+    for (int i = 0; i < breaks->count; i++) {
+        const Breakpoint *point = &breaks->points[i];
+        if (point->address != address) continue;
+        if (point->length == 0 || conditionHolds(vm, r, point->code)) {
+            breaks->hitIndex = i;
+            return 1;
+        }
+    }
+    return 0;
+}
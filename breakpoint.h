@@ -0,0 +1,102 @@
+// Breakpoints: stop a run before the instruction at an address, optionally only when a
+// condition on the registers and memory holds.
+// Created by Jackson Eshbaugh on 16.10.2026.
+//
+// A condition is compiled once, when the breakpoint is set, into a short program for a
+// stack machine (see BreakOp). Runs don't look at breakpoints at all, except at the
+// addresses set in the breakpoint map: the decode cache entry for such an address
+// dispatches to OP_BREAK, which runs the conditions there and either stops or goes on to
+// run the instruction.
+//
+// Conditions compare two operands with ==, !=, <, <=, > or >=, and can be joined with &&
+// and || (&& binding tighter). An operand is a register (R0-R3, AC, SP, BP, PC, IR), a
+// word of memory (M[<address>] or M[<register>]), or a number (decimal, or hex with 0x).
+// Values compare as signed 16-bit numbers, so "AC < 0" means AC is negative.
+// Conditions see PC and IR as they will be when the run stops: PC is the breakpoint's
+// address, and IR the instruction there.
+
+#ifndef BREAKPOINT_H
+#define BREAKPOINT_H
+
+#include "vm.h"
+
+#define BREAK_MAX 16
+#define BREAK_CODE_MAX 96 // bytes of compiled condition
+#define BREAK_STACK_MAX 16
+#define BREAK_TEXT_MAX 64
+
+/**
+ * The operations of a compiled condition. Operands follow the opcode byte: a register
+ * number (one byte), or a word (two bytes, big-endian).
+ */
+typedef enum {
+ BREAK_END = 0, // stop; the condition holds if the top of the stack is non-zero
+ BREAK_REGISTER, // push a register
+ BREAK_MEMORY, // push the word at an address
+ BREAK_MEMORY_AT, // push the word at the address a register holds
+ BREAK_CONSTANT, // push a word
+ BREAK_EQ, // pop two values, and push 1 if the comparison holds or 0 if not
+ BREAK_NE,
+ BREAK_LT,
+ BREAK_LE,
+ BREAK_GT,
+ BREAK_GE,
+ BREAK_AND, // pop two values, and push 1 if both are non-zero
+ BREAK_OR // pop two values, and push 1 if either is non-zero
+} BreakOp;
+
+/**
+ * A breakpoint, and its compiled condition (empty if it has none).
+ */
+typedef struct {
+    unsigned short address;
+    unsigned char code[BREAK_CODE_MAX];
+    int length; // 0 for no condition
+    char text[BREAK_TEXT_MAX]; // the condition as typed, for listing
+} Breakpoint;
+
+/**
+ * A VM's breakpoints, and the one most recently hit.
+ */
+typedef struct BreakList {
+    Breakpoint points[BREAK_MAX];
+    int count;
+    unsigned char map[MEMORY_SIZE / 8]; // a bit for each address with a breakpoint
+    int hitIndex;
+} BreakList;
+
+/**
+ * Whether any breakpoint is set at an address.
+ * @param breaks the breakpoints
+ * @param address the address
+ */
+#define BREAK_AT(breaks, address) ((breaks)->map[(unsigned short) (address) >> 3] & (1 << ((address) & 7)))
+
+/**
+ * Compiles a condition and sets a breakpoint at an address.
+ * @param vm the VM
+ * @param address the address of the instruction to stop before
+ * @param condition the condition, or NULL or "" to stop every time
+ * @param error set to what was wrong with the condition, if it couldn't be compiled
+ * @return 1 on success, 0 if the condition was bad, all BREAK_MAX breakpoints are in use,
+ *         or the list couldn't be allocated
+ */
+int addBreakpoint(SsamVm *vm, unsigned short address, const char *condition, const char **error);
+
+/**
+ * Removes every breakpoint.
+ * @param vm the VM
+ */
+void clearBreakpoints(SsamVm *vm);
+
+/**
+ * Checks the breakpoints at an address, setting hitIndex to the first one whose condition
+ * holds. Only called at addresses in the map.
+ * @param vm the VM
+ * @param r the registers to test the conditions against
+ * @param address the address about to run
+ * @return 1 if a breakpoint was hit, 0 if not
+ */
+int breakpointHit(SsamVm *vm, const unsigned short *r, unsigned short address);
+
+#endif //BREAKPOINT_H
@@ -0,0 +1,125 @@
+// Saves a VM's full state to a compact binary file, and loads it back.
+// Created by Jackson Eshbaugh on 16.10.2026.
+
+#include "checkpoint.h"
+#include "controller.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HEADER_SIZE (4 + 1 + REG_COUNT * 2 + 1 + 2 + 2 + 2)
+#define PAGE_RECORD_SIZE (2 + PAGE_BYTES)
+
+/**
+ * Appends a big-endian word to a buffer.
+ * @param buffer where to write the word
+ * @param value the word
+ * @return the byte after the word
+ */
+unsigned char *putWord(unsigned char *buffer, unsigned short value) {
+    buffer[0] = value >> 8;
+    buffer[1] = value & 0xFF;
+    return buffer + 2;
+}
+
+/**
+ * Reads a big-endian word from a buffer.
+ * @param buffer where to read the word
+ * @return the word
+ */
+unsigned short readWord(const unsigned char *buffer) {
+    return buffer[0] << 8 | buffer[1];
+}
+
+/**
+ * Determines if a page of memory is all zeros.
+ * @param page the first byte of the page
+ * @return 1 if every byte is zero, 0 otherwise
+ */
+int pageIsZero(const unsigned char *page) {
+    for (int i = 0; i < PAGE_BYTES; i++) {
+        if (page[i]) return 0;
+    }
+    return 1;
+}
+
+int saveCheckpoint(SsamVm *vm, const char *path, unsigned short sp, unsigned short pc) {
+    unsigned short pages[PAGE_COUNT];
+    int pageCount = 0;
+    for (int page = 0; page < PAGE_COUNT; page++) {
+        if (!pageIsZero(vm->memory + (page << PAGE_SHIFT))) pages[pageCount++] = page;
+    }
+
+    unsigned char header[HEADER_SIZE];
+    unsigned char *cursor = header;
+    memcpy(cursor, CHECKPOINT_MAGIC, 4);
+    cursor += 4;
+    *cursor++ = CHECKPOINT_VERSION;
+    for (int i = 0; i < REG_COUNT; i++) cursor = putWord(cursor, vm->R[i]);
+    *cursor++ = vm->flags;
+    cursor = putWord(cursor, sp);
+    cursor = putWord(cursor, pc);
+    putWord(cursor, pageCount);
+
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        fprintf(stderr, "Error: %s could not be opened.\n", path);
+        return 1;
+    }
+    int failed = fwrite(header, HEADER_SIZE, 1, file) != 1;
+    for (int i = 0; i < pageCount && !failed; i++) {
+        unsigned char number[2];
+        putWord(number, pages[i]);
+        failed = fwrite(number, 2, 1, file) != 1
+                 || fwrite(vm->memory + (pages[i] << PAGE_SHIFT), PAGE_BYTES, 1, file) != 1;
+    }
+    if (fclose(file) != 0) failed = 1;
+    if (failed) fprintf(stderr, "Error: %s could not be written.\n", path);
+    return failed;
+}
+
+int loadCheckpoint(SsamVm *vm, const char *path, unsigned short *sp, unsigned short *pc) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Error: checkpoint \"%s\" could not be opened.\n", path);
+        return 1;
+    }
+
+    unsigned char header[HEADER_SIZE];
+    if (fread(header, HEADER_SIZE, 1, file) != 1 || memcmp(header, CHECKPOINT_MAGIC, 4) != 0
+        || header[4] != CHECKPOINT_VERSION) {
+        fprintf(stderr, "Error: \"%s\" isn't a version %d checkpoint.\n", path, CHECKPOINT_VERSION);
+        fclose(file);
+        return 1;
+    }
+
+    resetVm(vm);
+    const unsigned char *cursor = header + 5;
+    for (int i = 0; i < REG_COUNT; i++, cursor += 2) vm->R[i] = readWord(cursor);
+    vm->flags = *cursor++;
+    *sp = readWord(cursor);
+    *pc = readWord(cursor + 2);
+    int pageCount = readWord(cursor + 4);
+
+    // All the pages are read in one go, then copied into place
+    unsigned char *records = malloc((size_t) pageCount * PAGE_RECORD_SIZE + 1);
+    int failed = !records || fread(records, PAGE_RECORD_SIZE, pageCount, file) != (size_t) pageCount;
+    for (int i = 0; i < pageCount && !failed; i++) {
+        const unsigned char *record = records + i * PAGE_RECORD_SIZE;
+        unsigned short page = readWord(record);
+        if (page >= PAGE_COUNT) {
+            failed = 1;
+            break;
+        }
+        memcpy(vm->memory + (page << PAGE_SHIFT), record + 2, PAGE_BYTES);
+    }
+    free(records);
+    fclose(file);
+
+    if (failed) {
+        fprintf(stderr, "Error: checkpoint \"%s\" is cut off or corrupt.\n", path);
+        resetVm(vm);
+        return 1;
+    }
+    return 0;
+}
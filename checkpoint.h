@@ -0,0 +1,39 @@
+// Saves a VM's full state to a compact binary file, and loads it back.
+// Created by Jackson Eshbaugh on 16.10.2026.
+//
+// A checkpoint file holds, all big-endian:
+// - the magic bytes "SSCK" and a version byte (1)
+// - the registers R0 through IR, one word each, then the flags byte
+// - the stack pointer and program counter the run started from (used by the state dumps)
+// - a word giving the number of pages saved, then for each page its number (a word) and
+//   its 256 bytes. Pages that are all zero are left out.
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "vm.h"
+
+#define CHECKPOINT_MAGIC "SSCK"
+#define CHECKPOINT_VERSION 1
+
+/**
+ * Writes the VM's registers, flags and every non-zero page of memory to a file.
+ * @param vm the VM
+ * @param path the file to write
+ * @param sp the stack pointer the run started from
+ * @param pc the program counter the run started from
+ * @return 0 on success, 1 if the file couldn't be written
+ */
+int saveCheckpoint(SsamVm *vm, const char *path, unsigned short sp, unsigned short pc);
+
+/**
+ * Resets the VM and loads a checkpoint into it.
+ * @param vm the VM
+ * @param path the file to read
+ * @param sp set to the stack pointer the run started from
+ * @param pc set to the program counter the run started from
+ * @return 0 on success, 1 if the file couldn't be read or isn't a checkpoint
+ */
+int loadCheckpoint(SsamVm *vm, const char *path, unsigned short *sp, unsigned short *pc);
+
+#endif //CHECKPOINT_H
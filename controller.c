@@ -3,11 +3,21 @@
 
 #include "controller.h"
 
+#include "decode.h"
 #include "memory.h"
-#define REG_COUNT 9
-
-char flags = 0x0; // 0th bit is the haltReached flag; 1st is the error flag.
-unsigned short R[REG_COUNT];
+#ifdef SSAM_JIT
+#include "jit.h"
+#endif
+#ifdef SSAM_PROFILE
+#include "profile.h"
+#endif
+#include "undo.h"
+#include "watch.h"
+#include "trace.h"
+#include "breakpoint.h"
+#include "loop.h"
+#include <string.h>
+#include <time.h>
 
 // flow operations
 
@@ -19,11 +29,11 @@ unsigned short R[REG_COUNT];
  * R[SP] <== R[SP] - 0x02
  * R[PC] <== M[R[SP]]
  */
-void ret() {
-    R[SP] = R[BP];
-    R[BP] = getWord(R[SP]);
-    R[SP] = R[SP] - 0x02;
-    R[PC] = getWord(R[SP]);
+void ret(SsamVm *vm) {
+    vm->R[SP] = vm->R[BP];
+    vm->R[BP] = getWord(vm, vm->R[SP]);
+    vm->R[SP] = vm->R[SP] - 0x02;
+    vm->R[PC] = getWord(vm, vm->R[SP]);
 }
 
 // transfer operations
@@ -35,8 +45,8 @@ void ret() {
  * @param reg the register to load the immediate into
  * @param immediate the immediate to load into the register
  */
-void lodi(Register reg, char immediate) {
-    R[reg] = (short) immediate;
+void lodi(SsamVm *vm, Register reg, char immediate) {
+    vm->R[reg] = (short) immediate;
 }
 
 /**
@@ -46,8 +56,8 @@ void lodi(Register reg, char immediate) {
  * @param reg the register to load the value into
  * @param address the location of the value in memory
  */
-void loda(Register reg, char address) {
-    R[reg] = getWord(address);
+void loda(SsamVm *vm, Register reg, char address) {
+    vm->R[reg] = getWord(vm, address);
 }
 
 /**
@@ -57,8 +67,8 @@ void loda(Register reg, char address) {
  * @param regA the register to load the value into
  * @param regB the location to load from in memory
  */
-void lodr(Register regA, Register regB) {
-    R[regA] = getWord(regB);
+void lodr(SsamVm *vm, Register regA, Register regB) {
+    vm->R[regA] = getWord(vm, regB);
 }
 
 /**
@@ -69,8 +79,8 @@ void lodr(Register regA, Register regB) {
  * @param regB register with base memory address to load at
  * @param offset index by which to offset R[regB] by when indexing
  */
-void lodrd(Register regA, Register regB, char offset) {
-    R[regA] = getWord(R[regB] + offset);
+void lodrd(SsamVm *vm, Register regA, Register regB, char offset) {
+    vm->R[regA] = getWord(vm, vm->R[regB] + offset);
 }
 
 /**
@@ -80,8 +90,8 @@ void lodrd(Register regA, Register regB, char offset) {
  * @param reg the register to store in memory
  * @param address the location to store R[reg] in memory
  */
-void stoa(Register reg, char address) {
-    setWord(address, R[reg]);
+void stoa(SsamVm *vm, Register reg, char address) {
+    setWord(vm, address, vm->R[reg]);
 }
 
 /**
@@ -91,8 +101,8 @@ void stoa(Register reg, char address) {
  * @param regA the register holding the value to store
  * @param regB the register holding the address to store at
  */
-void stor(Register regA, Register regB) {
-    setWord(R[regB], R[regA]);
+void stor(SsamVm *vm, Register regA, Register regB) {
+    setWord(vm, vm->R[regB], vm->R[regA]);
 }
 
 /**
@@ -103,8 +113,8 @@ void stor(Register regA, Register regB) {
  * @param regB the register holding the address to store R[regA] at
  * @param offset the offset from the address R[regB] to store R[regA] at
  */
-void stord(Register regA, Register regB, char offset) {
-    setWord(R[regB] + offset, R[regA]);
+void stord(SsamVm *vm, Register regA, Register regB, char offset) {
+    setWord(vm, vm->R[regB] + offset, vm->R[regA]);
 }
 
 // manipulate operations
@@ -115,10 +125,10 @@ void stord(Register regA, Register regB, char offset) {
  * R[AC] <== -R[reg]
  * @param reg the register to negate
  */
-void neg(Register reg) {
+void neg(SsamVm *vm, Register reg) {
     // R[AC] = ~R[reg];
     // R[AC] += 1;
-    R[AC] = -R[reg];
+    vm->R[AC] = -vm->R[reg];
 }
 
 /**
@@ -128,8 +138,8 @@ void neg(Register reg) {
  * @param regA an addend
  * @param regB another addend
  */
-void addr(Register regA, Register regB) {
-    R[AC] = R[regA] + R[regB];
+void addr(SsamVm *vm, Register regA, Register regB) {
+    vm->R[AC] = vm->R[regA] + vm->R[regB];
 }
 
 /**
@@ -139,8 +149,8 @@ void addr(Register regA, Register regB) {
  * @param reg an addend
  * @param immediate another addend
  */
-void addi(Register reg, char immediate) {
-    R[AC] = R[reg] + immediate;
+void addi(SsamVm *vm, Register reg, char immediate) {
+    vm->R[AC] = vm->R[reg] + immediate;
 }
 
 /**
@@ -150,8 +160,8 @@ void addi(Register reg, char immediate) {
  * @param regA the value to subtract R[regB] from
  * @param regB the value to subtract from R[regA]
  */
-void subr(Register regA, Register regB) {
-    R[AC] = R[regA] - R[regB];
+void subr(SsamVm *vm, Register regA, Register regB) {
+    vm->R[AC] = vm->R[regA] - vm->R[regB];
 }
 
 /**
@@ -161,8 +171,8 @@ void subr(Register regA, Register regB) {
  * @param reg the register to subtract the immediate from
  * @param immediate the immediate to subtract from the register
  */
-void subi(Register reg, char immediate) {
-    R[AC] = R[reg] - immediate;
+void subi(SsamVm *vm, Register reg, char immediate) {
+    vm->R[AC] = vm->R[reg] - immediate;
 }
 
 /**
@@ -172,8 +182,8 @@ void subi(Register reg, char immediate) {
  * @param regA the value to copy into regB
  * @param regB the location to copy the value in regA to.
  */
-void mov(Register regA, Register regB) {
-    R[regA] = R[regB];
+void mov(SsamVm *vm, Register regA, Register regB) {
+    vm->R[regA] = vm->R[regB];
 }
 
 // jmp operations
@@ -184,8 +194,8 @@ void mov(Register regA, Register regB) {
  * R[PC] <== address
  * @param address the address to jump to
  */
-void jmp(short address) {
-    R[PC] = address;
+void jmp(SsamVm *vm, short address) {
+    vm->R[PC] = address;
 }
 
 /**
@@ -194,8 +204,8 @@ void jmp(short address) {
  * R[PC] <== address [IF R[AC] == 0]
  * @param address the address to jump to
  */
-void jmpz(short address) {
-    if (R[AC] == 0x0000) R[PC] = address;
+void jmpz(SsamVm *vm, short address) {
+    if (vm->R[AC] == 0x0000) vm->R[PC] = address;
 }
 
 /**
@@ -204,8 +214,8 @@ void jmpz(short address) {
  * R[PC] <== address [IF R[AC] < 0]
  * @param address the address to jump to
  */
-void jmpn(short address) {
-    if ((short) R[AC] < 0) R[PC] = address;
+void jmpn(SsamVm *vm, short address) {
+    if ((short) vm->R[AC] < 0) vm->R[PC] = address;
 }
 
 /**
@@ -219,174 +229,569 @@ void jmpn(short address) {
  * R[SP] <== R[SP] + 0x02
  * @param address the address to call
  */
-void call(short address) {
-    setWord(R[SP], R[PC]);
-    R[SP] = R[SP] + 0x02;
-    R[PC] = address;
-    setWord(R[SP], R[BP]);
-    R[BP] = R[SP];
-    R[SP] = R[SP] + 0x02;
+void call(SsamVm *vm, short address) {
+    setWord(vm, vm->R[SP], vm->R[PC]);
+    vm->R[SP] = vm->R[SP] + 0x02;
+    vm->R[PC] = address;
+    setWord(vm, vm->R[SP], vm->R[BP]);
+    vm->R[BP] = vm->R[SP];
+    vm->R[SP] = vm->R[SP] + 0x02;
+}
+
+
+/**
+ * Decodes the instruction at address into its decode cache entry, fusing it with the
+ * instruction after it where possible. Its memory is marked as code, so writes to it
+ * invalidate the entry. An instruction with a breakpoint on it dispatches to OP_BREAK,
+ * and is never fused, nor fused into.
+ * @param address the address of the instruction
+ * @return the decoded instruction at address
+ */
+DecodedInstruction *decodeAt(SsamVm *vm, unsigned short address) {
+    DecodedInstruction *entry = &vm->decodeCache[(address >> 1) & DECODE_CACHE_MASK];
+    decodeInstruction(getWord(vm, address), entry);
+    entry->tag = address;
+    entry->valid = 1;
+    markCode(vm, address);
+
+    BreakList *breaks = vm->breaks;
+    if (breaks && BREAK_AT(breaks, address)) {
+        entry->fusedOp = OP_BREAK;
+        return entry;
+    }
+    if ((entry->op == OP_SUBI || entry->op == OP_ADDI || entry->op == OP_LODI) &&
+        !(breaks && BREAK_AT(breaks, address + 0x02))) {
+        DecodedInstruction next;
+        unsigned short nextAddress = address + 0x02;
+        decodeInstruction(getWord(vm, nextAddress), &next);
+        if (fuseInstructions(entry, &next)) markCode(vm, nextAddress);
+    }
+    return entry;
+}
+
+/**
+ * Looks up the decoded instruction at address, decoding it if it isn't cached yet.
+ * @param address the address of the instruction
+ * @return the decoded instruction at address
+ */
+DecodedInstruction *lookupDecoded(SsamVm *vm, unsigned short address) {
+    DecodedInstruction *entry = &vm->decodeCache[(address >> 1) & DECODE_CACHE_MASK];
+    if (!entry->valid || entry->tag != address) entry = decodeAt(vm, address);
+    return entry;
+}
+
+int dataAccesses(SsamVm *vm, const DecodedInstruction *d, MemoryAccess accesses[2]) {
+    // A register operand of PC is read after fetch() has moved it past the instruction
+    unsigned short base = d->regB == PC ? vm->R[PC] + 0x02 : vm->R[d->regB];
+    switch (d->op) {
+        case OP_RET:
+            accesses[0] = (MemoryAccess) {vm->R[BP], 0};
+            accesses[1] = (MemoryAccess) {vm->R[BP] - 0x02, 0};
+            return 2;
+        case OP_LODA:
+            accesses[0] = (MemoryAccess) {(char) d->imm, 0};
+            return 1;
+        case OP_LODR:
+            accesses[0] = (MemoryAccess) {d->regB, 0};
+            return 1;
+        case OP_LODRD:
+            accesses[0] = (MemoryAccess) {base + (char) d->imm, 0};
+            return 1;
+        case OP_STOA:
+            accesses[0] = (MemoryAccess) {(char) d->imm, 1};
+            return 1;
+        case OP_STOR:
+            accesses[0] = (MemoryAccess) {base, 1};
+            return 1;
+        case OP_STORD:
+            accesses[0] = (MemoryAccess) {base + (char) d->imm, 1};
+            return 1;
+        case OP_CALL:
+            accesses[0] = (MemoryAccess) {vm->R[SP], 1};
+            accesses[1] = (MemoryAccess) {vm->R[SP] + 0x02, 1};
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+void controllerInit(SsamVm *vm, short sp, short pc) {
+    vm->R[R0] = 0x0000;
+    vm->R[R1] = 0x0000;
+    vm->R[R2] = 0x0000;
+    vm->R[R3] = 0x0000;
+    vm->R[AC] = 0x0000;
+    vm->R[SP] = sp;
+    vm->R[BP] = sp - 0x02;
+    vm->R[PC] = pc;
+    vm->R[IR] = 0x0000;
+    vm->flags = 0x0;
+
+    resetDecoded(vm);
+}
+
+int errorOccurred(SsamVm *vm) {
+    return vm->flags & 0x2;
 }
 
+int haltReached(SsamVm *vm) {
+    return vm->flags & 0x1;
+}
 
-void controllerInit(short sp, short pc) {
-    R[R0] = 0x0000;
-    R[R1] = 0x0000;
-    R[R2] = 0x0000;
-    R[R3] = 0x0000;
-    R[AC] = 0x0000;
-    R[SP] = sp;
-    R[BP] = sp - 0x02;
-    R[PC] = pc;
-    R[IR] = 0x0000;
-    flags = 0x0;
+void predecode(SsamVm *vm, unsigned short start, unsigned short end) {
+    for (unsigned short address = start; address < end; address += 0x02) {
+        decodeAt(vm, address);
+    }
 }
 
-int errorOccurred() {
-    return flags & 0x2;
+void resetDecoded(SsamVm *vm) {
+    // Entries that are already invalid aren't written, so a new VM's cache stays untouched
+    for (int i = 0; i < DECODE_CACHE_SIZE; i++) {
+        if (vm->decodeCache[i].valid) vm->decodeCache[i].valid = 0;
+    }
+    vm->current = 0;
+#ifdef SSAM_JIT
+    jitReset(vm);
+#endif
 }
 
-int haltReached() {
-    return flags & 0x1;
+void invalidateDecoded(SsamVm *vm, unsigned short address) {
+    // A word written at address overlaps the instructions starting at address - 1 through
+    // address + 1, and the superinstructions starting at address - 3 and address - 2.
+    for (int i = -3; i <= 1; i++) {
+        unsigned short start = address + i;
+        DecodedInstruction *entry = &vm->decodeCache[(start >> 1) & DECODE_CACHE_MASK];
+        if (entry->valid && entry->tag == start) entry->valid = 0;
+    }
+#ifdef SSAM_JIT
+    jitInvalidate(vm, address);
+#endif
 }
 
-void fetch() {
-    if (haltReached()) return; // Don't do any more work if a halt was reached
+void fetch(SsamVm *vm) {
+    if (haltReached(vm)) return; // Don't do any more work if a halt was reached
+    vm->cycles++;
 
-    // Copy the contents of memory at PC into IR.
+    // Copy the contents of memory at PC into IR, via the decode cache.
     // R[IR] <== M[R[PC]]
-    R[IR] = getWord(R[PC]);
+    vm->current = lookupDecoded(vm, vm->R[PC]);
+    if (vm->undo) undoRecord(vm, vm->current);
+    if (vm->watch) watchCheck(vm, vm->current);
+    if (vm->trace) traceFetch(vm, vm->current);
+    vm->R[IR] = vm->current->word;
     // Increment the PC
-    R[PC] = R[PC] + 0x02;
-}
-
-void execute() {
-    if (haltReached()) return; // Don't do any more work if a halt was reached
-
-    int offset;
-
-    // Decode the instruction in IR,
-    // then execute that instruction
-    switch (R[IR] & 0xc000) {
-        case 0x0000:
-            // flow operation
-            switch (R[IR] & 0x1800) {
-                case 0x0000:
-                    // halt; set halt flag
-                    flags |= 0x1;
-                    break;
-                case 0x0800:
-                    // nop; do nothing
-                    break;
-                case 0x1000:
-                    // ret
-                    ret();
-                    break;
-                default:
-                    // error; set error flag
-                    flags |= 0x2;
-                    break;
-            }
+    vm->R[PC] = vm->R[PC] + 0x02;
+}
+
+void execute(SsamVm *vm) {
+    if (haltReached(vm)) return; // Don't do any more work if a halt was reached
+
+    // IR was loaded some other way than fetch(); decode it directly.
+    if (!vm->current || vm->current->word != vm->R[IR]) {
+        decodeInstruction(vm->R[IR], &vm->scratch);
+        vm->scratch.tag = vm->R[PC] - 0x02;
+        vm->current = &vm->scratch;
+    }
+
+#ifdef SSAM_PROFILE
+    if (vm->profile) profileInstruction(vm->profile, vm->current, vm->R[AC]);
+#endif
+
+    // Execute the decoded instruction
+    switch (vm->current->op) {
+        case OP_HALT:
+            // halt; set halt flag
+            vm->flags |= 0x1;
             break;
-        case 0x4000:
-            switch (R[IR] & 0x3800) {
-                // transfer operation
-                case 0x0000:
-                    lodi((R[IR] & 0x0700) >> 8, R[IR] & 0x00ff);
-                break;
-                case 0x0800:
-                    loda((R[IR] & 0x0700) >> 8, R[IR] & 0x00ff);
-                break;
-                case 0x1000:
-                    lodr((R[IR] & 0x0700) >> 8, (R[IR] & 0x00e0) >> 5);
-                break;
-                case 0x1800:
-                    offset = R[IR] & 0x001f;
-                    if (offset & 0x10) {
-                        offset -= 32;
-                    }
-                    lodrd((R[IR] & 0x0700) >> 8, (R[IR] & 0x00e0) >> 5, offset);
-                break;
-                case 0x2000:
-                    stoa((R[IR] & 0x0700) >> 8, R[IR] & 0x00ff);
-                break;
-                case 0x2800:
-                    stor((R[IR] & 0x0700) >> 8, (R[IR] & 0x00e0) >> 5);
-                break;
-                case 0x3000:
-                    offset = R[IR] & 0x001f;
-                    if (offset & 0x10) {
-                        offset -= 32;
-                    }
-                    stord((R[IR] & 0x0700) >> 8, (R[IR] & 0x00e0) >> 5, offset);
-                break;
-                default:
-                    flags |= 0x2;
-                break;
-            }
+        case OP_NOP:
+            // nop; do nothing
             break;
-        case 0x8000:
-
-            // manipulate operation
-            switch(R[IR] & 0x3800) {
-                case 0x0000:
-                    neg((R[IR] & 0x0700) >> 8);
-                    break;
-                case 0x0800:
-                    addr((R[IR] & 0x0700) >> 8, (R[IR] & 0x00ff) >> 5);
-                    break;
-                case 0x1000:
-                    addi((R[IR] & 0x0700) >> 8, R[IR] & 0x00ff);
-                    break;
-                case 0x1800:
-                    subr((R[IR] & 0x0700) >> 8, (R[IR] & 0x00ff) >> 5);
-                    break;
-                case 0x2000:
-                    subi((R[IR] & 0x0700) >> 8, R[IR] & 0x00ff);
-                    break;
-                case 0x3800:
-                    mov((R[IR] & 0x0700) >> 8, (R[IR] & 0x00ff) >> 5);
-                    break;
-                default:
-                    flags |= 0x2;
-                    break;
-            }
+        case OP_RET:
+            ret(vm);
             break;
-        case 0xc000:
-            // jump operation
-            switch (R[IR] & 0x3000) {
-                case 0x0000:
-                    // 1100
-                    jmp(0x0fff & R[IR]);
-                    break;
-
-                case 0x1000:
-                    // 1101
-                    jmpz(0x0fff & R[IR]);
-                    break;
-
-                case 0x2000:
-                    // 1110
-                    jmpn(0x0fff & R[IR]);
-                    break;
-
-                case 0x3000:
-                    // 1111
-                    call(0x0fff & R[IR]);
-                    break;
-
-                default:
-                    flags |= 0x2;
-                    break;
-            }
+        case OP_LODI:
+            lodi(vm, vm->current->regA, vm->current->imm);
+            break;
+        case OP_LODA:
+            loda(vm, vm->current->regA, vm->current->imm);
+            break;
+        case OP_LODR:
+            lodr(vm, vm->current->regA, vm->current->regB);
+            break;
+        case OP_LODRD:
+            lodrd(vm, vm->current->regA, vm->current->regB, vm->current->imm);
+            break;
+        case OP_STOA:
+            stoa(vm, vm->current->regA, vm->current->imm);
+            break;
+        case OP_STOR:
+            stor(vm, vm->current->regA, vm->current->regB);
+            break;
+        case OP_STORD:
+            stord(vm, vm->current->regA, vm->current->regB, vm->current->imm);
+            break;
+        case OP_NEG:
+            neg(vm, vm->current->regA);
+            break;
+        case OP_ADDR:
+            addr(vm, vm->current->regA, vm->current->regB);
+            break;
+        case OP_ADDI:
+            addi(vm, vm->current->regA, vm->current->imm);
+            break;
+        case OP_SUBR:
+            subr(vm, vm->current->regA, vm->current->regB);
+            break;
+        case OP_SUBI:
+            subi(vm, vm->current->regA, vm->current->imm);
+            break;
+        case OP_MOV:
+            mov(vm, vm->current->regA, vm->current->regB);
+            break;
+        case OP_JMP:
+            jmp(vm, vm->current->imm);
+            break;
+        case OP_JMPZ:
+            jmpz(vm, vm->current->imm);
+            break;
+        case OP_JMPN:
+            jmpn(vm, vm->current->imm);
+            break;
+        case OP_CALL:
+            call(vm, vm->current->imm);
             break;
         default:
             // Operation not recognized; set error flag
-            flags |= 0x2;
+            vm->flags |= 0x2;
             break;
     }
+    if (vm->trace) traceExecute(vm);
+}
+
+// Dispatch engine for interpret(). The handler bodies are shared; only the way control
+// moves from one handler to the next differs. With SSAM_THREADED_DISPATCH each handler
+// jumps straight to the next one through a computed goto (a GNU C extension), giving the
+// host one indirect branch per handler instead of a single shared one.
+#define FETCH() \
+    if (steps == maxSteps) { \
+        status = RUN_BUDGET; \
+        goto done; \
+    } \
+    d = &vm->decodeCache[(r[PC] >> 1) & DECODE_CACHE_MASK]; \
+    if (!d->valid || d->tag != r[PC]) d = lookupDecoded(vm, r[PC]); \
+    r[IR] = d->word; \
+    r[PC] = r[PC] + 0x02; \
+    steps++
+
+// Fetches the second half of a superinstruction, stopping between the two if that is
+// where the step budget runs out.
+#define FUSED_FETCH() \
+    if (steps == maxSteps) DISPATCH(); \
+    r[IR] = d->word2; \
+    r[PC] = r[PC] + 0x02; \
+    steps++
+
+// A store to a device (see device.h) can halt the machine.
+#define STORED() \
+    if (vm->flags & 0x1) { \
+        status = RUN_HALTED; \
+        goto done; \
+    }
+
+#ifdef SSAM_THREADED_DISPATCH
+#define OPERATION(op) do_##op:
+#define DISPATCH() do { FETCH(); goto *dispatchTable[d->fusedOp]; } while (0)
+#define DISPATCH_AS(op) goto *dispatchTable[op]
+#else
+#define OPERATION(op) case op:
+#define DISPATCH() continue
+#define DISPATCH_AS(op) do { fusedOp = op; goto dispatch; } while (0)
+#endif
+
+RunStatus interpret(SsamVm *vm, unsigned long maxSteps) {
+    if (haltReached(vm)) return RUN_HALTED; // Don't do any more work if a halt was reached
+
+    // Work on a local copy of the registers so the compiler doesn't have to reload them
+    // after every out-of-line memory access; they are written back on exit.
+    unsigned short r[REG_COUNT];
+    for (int i = 0; i < REG_COUNT; i++) r[i] = vm->R[i];
+
+    DecodedInstruction *d = vm->current;
+    unsigned long steps = 0;
+    RunStatus status;
+    vm->runSteps = &steps; // so a cycle counter device can read it mid-run
+
+#ifdef SSAM_THREADED_DISPATCH
+    static const void *dispatchTable[OP_COUNT] = {
+        [OP_HALT] = &&do_OP_HALT, [OP_NOP] = &&do_OP_NOP, [OP_RET] = &&do_OP_RET,
+        [OP_LODI] = &&do_OP_LODI, [OP_LODA] = &&do_OP_LODA, [OP_LODR] = &&do_OP_LODR,
+        [OP_LODRD] = &&do_OP_LODRD, [OP_STOA] = &&do_OP_STOA, [OP_STOR] = &&do_OP_STOR,
+        [OP_STORD] = &&do_OP_STORD, [OP_NEG] = &&do_OP_NEG, [OP_ADDR] = &&do_OP_ADDR,
+        [OP_ADDI] = &&do_OP_ADDI, [OP_SUBR] = &&do_OP_SUBR, [OP_SUBI] = &&do_OP_SUBI,
+        [OP_MOV] = &&do_OP_MOV, [OP_JMP] = &&do_OP_JMP, [OP_JMPZ] = &&do_OP_JMPZ,
+        [OP_JMPN] = &&do_OP_JMPN, [OP_CALL] = &&do_OP_CALL, [OP_ERROR] = &&do_OP_ERROR,
+        [OP_SUBI_JMPN] = &&do_OP_SUBI_JMPN, [OP_ADDI_MOV] = &&do_OP_ADDI_MOV,
+        [OP_LODI_STOA] = &&do_OP_LODI_STOA, [OP_BREAK] = &&do_OP_BREAK
+    };
+
+    DISPATCH();
+#else
+    unsigned char fusedOp;
+    for (;;) {
+        FETCH();
+        fusedOp = d->fusedOp;
+
+dispatch:
+        switch (fusedOp) {
+#endif
+            OPERATION(OP_HALT)
+                vm->flags |= 0x1;
+                status = RUN_HALTED;
+                goto done;
+            OPERATION(OP_NOP)
+                DISPATCH();
+            OPERATION(OP_RET)
+                r[SP] = r[BP];
+                r[BP] = getWord(vm, r[SP]);
+                r[SP] = r[SP] - 0x02;
+                r[PC] = getWord(vm, r[SP]);
+                DISPATCH();
+            OPERATION(OP_LODI)
+                r[d->regA] = d->imm;
+                DISPATCH();
+            OPERATION(OP_LODA)
+                r[d->regA] = getWord(vm, d->imm);
+                DISPATCH();
+            OPERATION(OP_LODR)
+                r[d->regA] = getWord(vm, d->regB); // same as lodr()
+                DISPATCH();
+            OPERATION(OP_LODRD)
+                r[d->regA] = getWord(vm, r[d->regB] + d->imm);
+                DISPATCH();
+            OPERATION(OP_STOA)
+                setWord(vm, d->imm, r[d->regA]);
+                STORED();
+                DISPATCH();
+            OPERATION(OP_STOR)
+                setWord(vm, r[d->regB], r[d->regA]);
+                STORED();
+                DISPATCH();
+            OPERATION(OP_STORD)
+                setWord(vm, r[d->regB] + d->imm, r[d->regA]);
+                STORED();
+                DISPATCH();
+            OPERATION(OP_NEG)
+                r[AC] = -r[d->regA];
+                DISPATCH();
+            OPERATION(OP_ADDR)
+                r[AC] = r[d->regA] + r[d->regB];
+                DISPATCH();
+            OPERATION(OP_ADDI)
+                r[AC] = r[d->regA] + d->imm;
+                DISPATCH();
+            OPERATION(OP_SUBR)
+                r[AC] = r[d->regA] - r[d->regB];
+                DISPATCH();
+            OPERATION(OP_SUBI)
+                r[AC] = r[d->regA] - d->imm;
+                DISPATCH();
+            OPERATION(OP_MOV)
+                r[d->regA] = r[d->regB];
+                DISPATCH();
+            OPERATION(OP_JMP)
+                r[PC] = d->imm;
+                DISPATCH();
+            OPERATION(OP_JMPZ)
+                if (r[AC] == 0x0000) r[PC] = d->imm;
+                DISPATCH();
+            OPERATION(OP_JMPN)
+                if ((short) r[AC] < 0) r[PC] = d->imm;
+                DISPATCH();
+            OPERATION(OP_CALL)
+                setWord(vm, r[SP], r[PC]);
+                r[SP] = r[SP] + 0x02;
+                r[PC] = d->imm;
+                setWord(vm, r[SP], r[BP]);
+                r[BP] = r[SP];
+                r[SP] = r[SP] + 0x02;
+                STORED();
+                DISPATCH();
+            OPERATION(OP_ERROR)
+                // Operation not recognized; set error flag
+                vm->flags |= 0x2;
+                status = RUN_ERROR;
+                goto done;
+
+            // Superinstructions. Each runs its first instruction, then (budget allowing)
+            // fetches and runs the second exactly as if it had been dispatched on its own.
+            OPERATION(OP_SUBI_JMPN)
+                r[AC] = r[d->regA] - d->imm;
+                FUSED_FETCH();
+                if ((short) r[AC] < 0) r[PC] = d->imm2;
+                DISPATCH();
+            OPERATION(OP_ADDI_MOV)
+                r[AC] = r[d->regA] + d->imm;
+                FUSED_FETCH();
+                r[d->regA2] = r[d->regB2];
+                DISPATCH();
+            OPERATION(OP_LODI_STOA)
+                r[d->regA] = d->imm;
+                FUSED_FETCH();
+                setWord(vm, d->imm2, r[d->regA2]);
+                STORED();
+                DISPATCH();
+
+            OPERATION(OP_BREAK)
+                // Stop before the instruction if a breakpoint's condition holds, unless it
+                // is the first one run, so a run started at a breakpoint can get past it.
+                if (steps > 1) {
+                    r[PC] = r[PC] - 0x02;
+                    if (breakpointHit(vm, r, r[PC])) {
+                        steps--;
+                        status = RUN_BREAK;
+                        goto done;
+                    }
+                    r[PC] = r[PC] + 0x02;
+                }
+                DISPATCH_AS(d->op);
+#ifndef SSAM_THREADED_DISPATCH
+            default:
+                vm->flags |= 0x2;
+                status = RUN_ERROR;
+                goto done;
+        }
+    }
+#endif
+
+done:
+    for (int i = 0; i < REG_COUNT; i++) vm->R[i] = r[i];
+    vm->current = d;
+    vm->cycles += steps;
+    vm->runSteps = NULL;
+    return status;
+}
+
+#undef FETCH
+#undef FUSED_FETCH
+#undef STORED
+#undef OPERATION
+#undef DISPATCH
+#undef DISPATCH_AS
+
+/**
+ * Checks the breakpoints at PC, as OP_BREAK does in interpret(): the conditions see IR
+ * already holding the instruction there, and so does the VM if one is hit.
+ * @param vm the VM
+ * @return 1 if a breakpoint was hit, 0 if not
+ */
+int breakpointAtPC(SsamVm *vm) {
+    BreakList *breaks = vm->breaks;
+    if (!breaks || !BREAK_AT(breaks, vm->R[PC])) return 0;
+
+    unsigned short r[REG_COUNT];
+    memcpy(r, vm->R, sizeof(r));
+    r[IR] = lookupDecoded(vm, r[PC])->word;
+    if (!breakpointHit(vm, r, r[PC])) return 0;
+    vm->R[IR] = r[IR];
+    return 1;
+}
+
+/**
+ * Runs like interpret(), but through fetch() and execute(), so each instruction can be
+ * counted in the VM's profile, recorded in its undo log and trace, and checked against
+ * its watchpoints and breakpoints. Superinstructions only ever run their first half here.
+ * @param vm the VM
+ * @param maxSteps the most instructions to run
+ * @return why execution stopped
+ */
+RunStatus instrumentedRun(SsamVm *vm, unsigned long maxSteps) {
+    for (unsigned long steps = 0; steps < maxSteps; steps++) {
+        // Like interpret(), a breakpoint where the run starts doesn't stop it
+        if (vm->breaks && steps > 0 && breakpointAtPC(vm)) return RUN_BREAK;
+        fetch(vm);
+        execute(vm);
+        if (haltReached(vm)) return RUN_HALTED;
+        if (vm->current->op == OP_ERROR) return RUN_ERROR;
+        if (vm->watch && vm->watch->hit) return RUN_WATCH;
+    }
+    return RUN_BUDGET;
+}
+
+RunStatus runUntil(SsamVm *vm, unsigned long maxSteps) {
+    if (haltReached(vm)) return RUN_HALTED; // Don't do any more work if a halt was reached
+
+    // Checked once per call rather than once per instruction, so leaving profiling,
+    // recording, watchpoints and tracing off costs the loops below nothing. Breakpoints
+    // cost nothing either, except at their own addresses (see decodeAt()).
+    if (vm->profile || vm->undo || vm->watch || vm->trace) return instrumentedRun(vm, maxSteps);
+#ifdef SSAM_JIT
+    // Native code loads straight from memory, so it can't see devices, and it doesn't
+    // check breakpoints
+    if (!vm->devices && !vm->breaks && jitAvailable(vm)) return jitRunUntil(vm, maxSteps);
+#endif
+    return interpret(vm, maxSteps);
+}
+
+/**
+ * Reads the monotonic clock.
+ * @return the time, in seconds
+ */
+double monotonicSeconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+RunStatus runLimited(SsamVm *vm, const RunLimits *limits) {
+    vm->stopped = 0;
+    double deadline = limits->timeout > 0 ? monotonicSeconds() + limits->timeout : 0;
+    unsigned long long start = vm->cycles;
+    // Devices make the next state depend on more than the VM's own (see loop.h)
+    int detecting = vm->loops && !vm->devices;
+    if (detecting) startLoopCheck(vm);
+
+    for (int first = 1;; first = 0) {
+        // A run that is picking up where the last chunk left off stops at a breakpoint
+        // there, which runUntil() would pass as the start of its run
+        if (!first && vm->breaks && !haltReached(vm) && breakpointAtPC(vm)) return RUN_BREAK;
+
+        // With a deadline, run in chunks and read the clock between them, and with loop
+        // detection, check for a loop between them; without either, the only chunk is the
+        // rest of the budget
+        unsigned long long chunk = deadline ? RUN_CHECK_STEPS : RUN_UNLIMITED;
+        if (detecting && loopStepsLeft(vm) < chunk) chunk = loopStepsLeft(vm);
+        if (limits->budget) {
+            unsigned long long run = vm->cycles - start;
+            if (run >= limits->budget) {
+                vm->stopped = STOP_BUDGET;
+                return RUN_BUDGET;
+            }
+            if (limits->budget - run < chunk) chunk = limits->budget - run;
+        }
+
+        RunStatus status = runUntil(vm, chunk);
+        if (status == RUN_ERROR) continue; // Errors don't stop the machine, so keep going past them
+        if (status != RUN_BUDGET) return status;
+        // Finding the loop's addresses runs it further, but not past the budget, nor more
+        // than a chunk past the clock's last reading
+        unsigned long long scan = LOOP_SCAN_MAX;
+        if (limits->budget && limits->budget - (vm->cycles - start) < scan) scan = limits->budget - (vm->cycles - start);
+        if (deadline && RUN_CHECK_STEPS < scan) scan = RUN_CHECK_STEPS;
+        if (detecting && loopStepsLeft(vm) == 0 && loopCheck(vm, scan)) {
+            vm->stopped = STOP_LOOP;
+            return RUN_LOOP;
+        }
+        if (deadline && monotonicSeconds() >= deadline) {
+            vm->stopped = STOP_TIMEOUT;
+            return RUN_TIMEOUT;
+        }
+    }
+}
+
+unsigned long long cyclesRun(SsamVm *vm) {
+    return vm->cycles + (vm->runSteps ? *vm->runSteps : 0);
 }
 
-unsigned short getRegister(Register reg) {
-    return R[reg];
+unsigned short getRegister(SsamVm *vm, Register reg) {
+    return vm->R[reg];
 }
\ No newline at end of file
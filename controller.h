@@ -4,6 +4,8 @@
 #ifndef CONTROLLER_H
 #define CONTROLLER_H
 
+#include "vm.h"
+
 typedef enum {
  R0 = 0,
  R1 = 1,
@@ -16,43 +18,163 @@ typedef enum {
  IR = 8
 } Register;
 
+#define RUN_UNLIMITED ((unsigned long) -1)
+#define RUN_CHECK_STEPS 0x100000 // instructions runLimited() runs between reads of the clock
+
+/**
+ * Why runUntil() returned.
+ */
+typedef enum {
+ RUN_HALTED = 0, // a halt instruction was executed
+ RUN_ERROR = 1, // an unrecognized instruction set the error flag
+ RUN_BUDGET = 2, // the step budget ran out
+ RUN_WATCH = 3, // an instruction touched a watched address (see watch.h)
+ RUN_BREAK = 4, // a breakpoint was hit, before its instruction ran (see breakpoint.h)
+ RUN_TIMEOUT = 5, // the deadline passed (only from runLimited())
+ RUN_LOOP = 6 // the VM is in a loop it can never leave (only from runLimited(); see loop.h)
+} RunStatus;
+
+/**
+ * The limits on a run to halt. Zero means no limit.
+ */
+typedef struct {
+ unsigned long long budget; // the most instructions to run
+ double timeout; // the most seconds to run for, by the wall clock
+} RunLimits;
+
+/**
+ * A word of memory an instruction loads or stores, besides its own instruction word.
+ */
+typedef struct {
+ unsigned short address;
+ unsigned char write; // 1 for a store, 0 for a load
+} MemoryAccess;
+
 /**
  * Initializes the controller by setting the registers to their correct default values.
  *
+ * @param vm the VM
  * @param sp the initial stack pointer (the base pointer will be calculated as sp + 0x02)
  * @param pc the initial program counter
  */
-void controllerInit(short sp, short pc);
+void controllerInit(SsamVm *vm, short sp, short pc);
 
 /**
  * Performs one fetch operation.
+ * @param vm the VM
  */
-void fetch();
+void fetch(SsamVm *vm);
 
 /**
  * Decodes the fetched operation, then executes it.
  * This is implemented with the help of helper functions for each possible operation.
  * fetch() should be called before execute().
+ * @param vm the VM
+ */
+void execute(SsamVm *vm);
+
+/**
+ * Runs fetch-execute cycles until a halt is reached, an error occurs, or maxSteps
+ * instructions have run. Equivalent to calling fetch() then execute() in a loop, but the
+ * whole loop runs inside one function with the registers held in locals.
+ * When built with SSAM_JIT, hot code is translated to native code (see jit.h). When the
+ * VM is being profiled (see profile.h) or recorded (see undo.h), instructions are run
+ * and counted or recorded one at a time.
+ *
+ * @param vm the VM
+ * @param maxSteps the most instructions to run (RUN_UNLIMITED for no limit)
+ * @return why execution stopped
+ */
+RunStatus runUntil(SsamVm *vm, unsigned long maxSteps);
+
+/**
+ * Runs until a halt is reached, a watchpoint or breakpoint is hit, a limit runs out, or
+ * (with loop detection on, and no devices mapped) the VM is found in a loop it can never
+ * leave. Errors don't stop the run. The budget is handed to runUntil() as its step limit, and
+ * with a timeout the run goes in chunks of RUN_CHECK_STEPS instructions, reading the clock
+ * between them, so neither limit costs anything per instruction; a timed-out run may go
+ * on for up to one chunk past its deadline. When a limit or a loop stops the run,
+ * vm->stopped says which, until the next run.
+ *
+ * @param vm the VM
+ * @param limits the limits
+ * @return why execution stopped: RUN_BUDGET if the budget ran out, RUN_TIMEOUT if the
+ *         deadline passed, RUN_LOOP if a loop was found, and otherwise as runUntil()
  */
-void execute();
+RunStatus runLimited(SsamVm *vm, const RunLimits *limits);
+
+/**
+ * The interpreter behind runUntil(); it never uses the JIT. The dispatch engine is chosen
+ * at build time (see SSAM_THREADED_DISPATCH).
+ *
+ * @param vm the VM
+ * @param maxSteps the most instructions to run (RUN_UNLIMITED for no limit)
+ * @return why execution stopped
+ */
+RunStatus interpret(SsamVm *vm, unsigned long maxSteps);
+
+/**
+ * Works out which words of memory an instruction will load or store. Called before fetch(),
+ * while the VM still holds the state the instruction starts from.
+ * @param vm the VM
+ * @param d the instruction at PC
+ * @param accesses set to the accesses, in the order the instruction makes them
+ * @return the number of accesses (0 to 2)
+ */
+int dataAccesses(SsamVm *vm, const DecodedInstruction *d, MemoryAccess accesses[2]);
+
+/**
+ * Counts the instructions the VM has run since it was created or reset, including those
+ * of a run still in progress.
+ * @param vm the VM
+ * @return the number of instructions run
+ */
+unsigned long long cyclesRun(SsamVm *vm);
 
 /**
  * Determines if a halt was reached
+ * @param vm the VM
  * @return 1 if halt reached, 0 otherwise
  */
-int haltReached();
+int haltReached(SsamVm *vm);
 
 /**
  * Determines if an error has occurred
+ * @param vm the VM
  * @return 1 if error occurred, 0 otherwise
  */
-int errorOccurred();
+int errorOccurred(SsamVm *vm);
+
+/**
+ * Decodes every instruction in [start, end) ahead of time, fusing common instruction
+ * pairs into superinstructions. Run once after loading a program.
+ * @param vm the VM
+ * @param start the address of the first instruction
+ * @param end the address just past the last instruction
+ */
+void predecode(SsamVm *vm, unsigned short start, unsigned short end);
+
+/**
+ * Empties the decode cache (and the JIT's translated code), e.g. after a new program
+ * is loaded into memory directly.
+ * @param vm the VM
+ */
+void resetDecoded(SsamVm *vm);
+
+/**
+ * Invalidates any decoded instruction that overlaps the word at address. Called by the
+ * memory when a word marked as code is written, so self-modifying code stays correct.
+ * @param vm the VM
+ * @param address the address of the word that was written
+ */
+void invalidateDecoded(SsamVm *vm, unsigned short address);
 
 /**
  * Gets the contents of a specified register.
+ * @param vm the VM
  * @param reg the register to get the contents of
  * @return the contents of the register reg
  */
-unsigned short getRegister(Register reg);
+unsigned short getRegister(SsamVm *vm, Register reg);
 
 #endif //CONTROLLER_H
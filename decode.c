@@ -0,0 +1,91 @@
+// Decodes SSAM instruction words into an operation and its pre-extracted operands.
+// Created by Jackson Eshbaugh on 16.10.2026.
+
+#include "decode.h"
+
+void decodeInstruction(unsigned short word, DecodedInstruction *out) {
+    out->word = word;
+    out->regA = (word & 0x0700) >> 8;
+    out->regB = (word & 0x00e0) >> 5;
+    out->imm = 0;
+
+    switch (word & 0xc000) {
+        case 0x0000:
+            // flow operation
+            switch (word & 0x1800) {
+                case 0x0000: out->op = OP_HALT; break;
+                case 0x0800: out->op = OP_NOP; break;
+                case 0x1000: out->op = OP_RET; break;
+                default: out->op = OP_ERROR; break;
+            }
+            break;
+        case 0x4000:
+            // transfer operation
+            switch (word & 0x3800) {
+                case 0x0000: out->op = OP_LODI; break;
+                case 0x0800: out->op = OP_LODA; break;
+                case 0x1000: out->op = OP_LODR; break;
+                case 0x1800: out->op = OP_LODRD; break;
+                case 0x2000: out->op = OP_STOA; break;
+                case 0x2800: out->op = OP_STOR; break;
+                case 0x3000: out->op = OP_STORD; break;
+                default: out->op = OP_ERROR; break;
+            }
+            if (out->op == OP_LODRD || out->op == OP_STORD) {
+                // 5-bit signed offset
+                out->imm = word & 0x001f;
+                if (out->imm & 0x10) {
+                    out->imm -= 32;
+                }
+            } else {
+                // 8-bit signed immediate or address
+                out->imm = (signed char) (word & 0x00ff);
+            }
+            break;
+        case 0x8000:
+            // manipulate operation
+            switch (word & 0x3800) {
+                case 0x0000: out->op = OP_NEG; break;
+                case 0x0800: out->op = OP_ADDR; break;
+                case 0x1000: out->op = OP_ADDI; break;
+                case 0x1800: out->op = OP_SUBR; break;
+                case 0x2000: out->op = OP_SUBI; break;
+                case 0x3800: out->op = OP_MOV; break;
+                default: out->op = OP_ERROR; break;
+            }
+            out->imm = (signed char) (word & 0x00ff);
+            break;
+        default:
+            // jump operation (0xc000); the target is always the low 12 bits
+            switch (word & 0x3000) {
+                case 0x0000: out->op = OP_JMP; break;
+                case 0x1000: out->op = OP_JMPZ; break;
+                case 0x2000: out->op = OP_JMPN; break;
+                default: out->op = OP_CALL; break;
+            }
+            out->imm = word & 0x0fff;
+            break;
+    }
+    out->fusedOp = out->op;
+}
+
+int fuseInstructions(DecodedInstruction *first, const DecodedInstruction *second) {
+    // The second instruction only runs next if the first doesn't write PC (register 7)
+    if (first->op == OP_LODI && first->regA == 7) return 0;
+
+    if (first->op == OP_SUBI && second->op == OP_JMPN) {
+        first->fusedOp = OP_SUBI_JMPN;
+    } else if (first->op == OP_ADDI && second->op == OP_MOV) {
+        first->fusedOp = OP_ADDI_MOV;
+    } else if (first->op == OP_LODI && second->op == OP_STOA) {
+        first->fusedOp = OP_LODI_STOA;
+    } else {
+        return 0;
+    }
+
+    first->regA2 = second->regA;
+    first->regB2 = second->regB;
+    first->imm2 = second->imm;
+    first->word2 = second->word;
+    return 1;
+}
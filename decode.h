@@ -0,0 +1,81 @@
+// Decodes SSAM instruction words into an operation and its pre-extracted operands.
+// Created by Jackson Eshbaugh on 16.10.2026.
+
+#ifndef DECODE_H
+#define DECODE_H
+
+/**
+ * Every operation an instruction word can decode to. OP_ERROR covers all encodings
+ * that execute() would previously have flagged as an error. The OP_*_* operations
+ * are only ever produced by fuseInstructions(), and OP_BREAK only for an instruction with
+ * a breakpoint on it (see breakpoint.h); both only ever appear as a fusedOp.
+ */
+typedef enum {
+ OP_HALT = 0,
+ OP_NOP,
+ OP_RET,
+ OP_LODI,
+ OP_LODA,
+ OP_LODR,
+ OP_LODRD,
+ OP_STOA,
+ OP_STOR,
+ OP_STORD,
+ OP_NEG,
+ OP_ADDR,
+ OP_ADDI,
+ OP_SUBR,
+ OP_SUBI,
+ OP_MOV,
+ OP_JMP,
+ OP_JMPZ,
+ OP_JMPN,
+ OP_CALL,
+ OP_ERROR,
+ // superinstructions: a pair of adjacent instructions run as one dispatch
+ OP_SUBI_JMPN,
+ OP_ADDI_MOV,
+ OP_LODI_STOA,
+ OP_BREAK, // check the breakpoints here, then run op
+ OP_COUNT
+} Operation;
+
+/**
+ * A decoded instruction. All masking, shifting and sign extension is done once here,
+ * so the execution loop only reads fields.
+ */
+typedef struct {
+ unsigned short tag; // address the instruction was decoded from
+ unsigned short word; // the raw instruction word (loaded into IR)
+ short imm; // sign-extended immediate/offset, or the 12-bit jump target
+ unsigned char op; // the Operation to run
+ unsigned char regA; // first register operand, bits 10-8
+ unsigned char regB; // second register operand, bits 7-5
+ unsigned char valid; // 1 if this entry holds a decoded instruction
+ unsigned char fusedOp; // the operation interpret() dispatches on: op, or a superinstruction
+ unsigned char regA2; // operands of the second instruction of a superinstruction
+ unsigned char regB2;
+ short imm2;
+ unsigned short word2;
+} DecodedInstruction;
+
+/**
+ * Decodes a single instruction word. The tag and valid fields of out are left untouched.
+ *
+ * @param word the instruction word to decode
+ * @param out the decoded instruction
+ */
+void decodeInstruction(unsigned short word, DecodedInstruction *out);
+
+/**
+ * Fuses two adjacent instructions into a superinstruction if they form a common idiom:
+ * subi + jmpn, addi + mov, or lodi + stoa. On success, first->fusedOp names the
+ * superinstruction and the operands of second are copied into first.
+ *
+ * @param first the first instruction; updated if the pair is fused
+ * @param second the instruction immediately after first
+ * @return 1 if the pair was fused, 0 otherwise
+ */
+int fuseInstructions(DecodedInstruction *first, const DecodedInstruction *second);
+
+#endif //DECODE_H
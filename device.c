@@ -0,0 +1,126 @@
+// A bus that maps ranges of guest addresses to devices run by the host.
+// Created by Jackson Eshbaugh on 16.10.2026.
+
+#include "device.h"
+#include "controller.h"
+#include <stdlib.h>
+
+int mapDevice(SsamVm *vm, unsigned short start, unsigned short end, DeviceRead read, DeviceWrite write,
+              void *state) {
+    if (end < start) return 0;
+    if (!vm->devices) vm->devices = calloc(1, sizeof(DeviceBus));
+    DeviceBus *bus = vm->devices;
+    if (!bus || bus->count == DEVICE_MAX) return 0;
+
+    bus->devices[bus->count++] = (Device) {start, end, read, write, state};
+    markDevicePages(vm);
+    return 1;
+}
+
+void markDevicePages(SsamVm *vm) {
+    if (!vm->devices) return;
+    for (int i = 0; i < vm->devices->count; i++) {
+        const Device *device = &vm->devices->devices[i];
+        for (int page = device->start >> PAGE_SHIFT; page <= device->end >> PAGE_SHIFT; page++) {
+            vm->pageFlags[page] |= PAGE_DEVICE;
+        }
+    }
+}
+
+/**
+ * Finds the device an address belongs to.
+ * @param vm the VM
+ * @param address the address
+ * @return the device, or NULL if the address is on a device page but no device's range
+ */
+Device *findDevice(SsamVm *vm, unsigned short address) {
+    DeviceBus *bus = vm->devices;
+    for (int i = 0; bus && i < bus->count; i++) {
+        if (address >= bus->devices[i].start && address <= bus->devices[i].end) return &bus->devices[i];
+    }
+    return NULL;
+}
+
+unsigned short deviceRead(SsamVm *vm, unsigned short address) {
+    Device *device = findDevice(vm, address);
+    if (device && device->read) return device->read(vm, device->state, address);
+    return vm->memory[address] << 8 | vm->memory[(unsigned short) (address + 1)];
+}
+
+void deviceWrite(SsamVm *vm, unsigned short address, unsigned short value) {
+    Device *device = findDevice(vm, address);
+    if (device && device->write) device->write(vm, device->state, address, value);
+}
+
+void flushDevices(SsamVm *vm) {
+    DeviceBus *bus = vm->devices;
+    if (!bus || bus->outputLength == 0) return;
+    fwrite(bus->output, 1, bus->outputLength, bus->out);
+    fflush(bus->out);
+    bus->outputLength = 0;
+}
+
+/**
+ * Adds text to the console output, writing the buffer out first if it would overflow.
+ * @param vm the VM
+ * @param text the characters to add
+ * @param length the number of characters
+ */
+void consoleOutput(SsamVm *vm, const char *text, int length) {
+    DeviceBus *bus = vm->devices;
+    if (bus->outputLength + length > DEVICE_OUTPUT_SIZE) flushDevices(vm);
+    for (int i = 0; i < length; i++) bus->output[bus->outputLength++] = text[i];
+}
+
+/**
+ * Handles stores to the standard devices' console, number console and exit ports.
+ * @param vm the VM
+ * @param state the base address of the ports
+ * @param address the port stored to
+ * @param value the word stored
+ */
+void standardWrite(SsamVm *vm, void *state, unsigned short address, unsigned short value) {
+    unsigned short port = address - *(unsigned short *) state;
+    if (port == PORT_CONSOLE) {
+        char c = (char) (value & 0xFF);
+        consoleOutput(vm, &c, 1);
+    } else if (port == PORT_NUMBER) {
+        char text[8];
+        consoleOutput(vm, text, snprintf(text, sizeof(text), "%hd\n", (short) value));
+    } else if (port == PORT_EXIT) {
+        vm->devices->exited = 1;
+        vm->devices->exitCode = value;
+        vm->flags |= 0x1;
+        flushDevices(vm);
+    }
+}
+
+/**
+ * Handles loads from the standard devices' cycle counter.
+ * @param vm the VM
+ * @param state the base address of the ports
+ * @param address the port loaded from
+ * @return the high or low word of the cycle count, or the word in memory for other ports
+ */
+unsigned short standardRead(SsamVm *vm, void *state, unsigned short address) {
+    unsigned short port = address - *(unsigned short *) state;
+    if (port == PORT_CYCLES) return cyclesRun(vm) >> 16;
+    if (port == PORT_CYCLES + 0x02) return cyclesRun(vm) & 0xFFFF;
+    return vm->memory[address] << 8 | vm->memory[(unsigned short) (address + 1)];
+}
+
+int mapStandardDevices(SsamVm *vm, unsigned short base, FILE *out) {
+    if (!vm->devices) vm->devices = calloc(1, sizeof(DeviceBus));
+    if (!vm->devices) return 0;
+
+    vm->devices->standardBase = base;
+    vm->devices->out = out;
+    return mapDevice(vm, base, base + PORT_EXIT + 0x01, standardRead, standardWrite, &vm->devices->standardBase);
+}
+
+void destroyDevices(SsamVm *vm) {
+    if (!vm->devices) return;
+    flushDevices(vm);
+    free(vm->devices);
+    vm->devices = NULL;
+}
@@ -0,0 +1,121 @@
+// A bus that maps ranges of guest addresses to devices run by the host.
+// Created by Jackson Eshbaugh on 16.10.2026.
+//
+// Pages holding a device are flagged PAGE_DEVICE. getWord() and setWord() check that flag
+// and only then come here, so loads and stores to plain RAM stay direct array accesses. A
+// word belongs to a device if its first byte does. Stores to a device page also land in
+// memory, so state dumps show the last word written to each port.
+//
+// mapStandardDevices() maps these ports, at offsets from a base address:
+// - 0x00 console: a store writes the low byte as a character
+// - 0x02 number console: a store writes the word as a signed decimal number and a newline
+// - 0x04 cycle counter: loads give the instructions run so far, high word first (0x04)
+//   then low word (0x06)
+// - 0x08 exit: a store halts the machine, with the word stored as the exit code
+// Console output is buffered and written out when the buffer fills, when the machine halts
+// through the exit port, and whenever flushDevices() is called.
+
+#ifndef DEVICE_H
+#define DEVICE_H
+
+#include "vm.h"
+#include <stdio.h>
+
+#define DEVICE_MAX 8
+#define DEVICE_BASE 0xFFF0 // where the standard devices are mapped by default (in reach of loda and stoa)
+#define DEVICE_OUTPUT_SIZE 4096
+
+#define PORT_CONSOLE 0x00
+#define PORT_NUMBER 0x02
+#define PORT_CYCLES 0x04
+#define PORT_EXIT 0x08
+
+typedef unsigned short (*DeviceRead)(SsamVm *vm, void *state, unsigned short address);
+typedef void (*DeviceWrite)(SsamVm *vm, void *state, unsigned short address, unsigned short value);
+
+/**
+ * A device mapped over start through end inclusive. Either handler may be NULL: loads
+ * then read memory, and stores are only kept in memory.
+ */
+typedef struct {
+    unsigned short start, end;
+    DeviceRead read;
+    DeviceWrite write;
+    void *state;
+} Device;
+
+/**
+ * The devices mapped into a VM, and the state of the standard ones.
+ */
+typedef struct DeviceBus {
+    Device devices[DEVICE_MAX];
+    int count;
+
+    FILE *out; // where console output goes
+    char output[DEVICE_OUTPUT_SIZE]; // console output not yet written
+    int outputLength;
+
+    unsigned short standardBase; // where mapStandardDevices() put the standard ports
+    int exited; // 1 once the exit port has been written
+    unsigned short exitCode;
+} DeviceBus;
+
+/**
+ * Maps a device. While a VM has any devices, runUntil() doesn't use the JIT.
+ * @param vm the VM
+ * @param start the first address of the device
+ * @param end the last address of the device
+ * @param read called for loads of a word starting in the range
+ * @param write called after a word starting in the range is stored
+ * @param state passed to the handlers
+ * @return 1 on success, 0 if end is below start, DEVICE_MAX devices are mapped or the bus
+ *         could not be allocated
+ */
+int mapDevice(SsamVm *vm, unsigned short start, unsigned short end, DeviceRead read, DeviceWrite write,
+              void *state);
+
+/**
+ * Maps the console, number console, cycle counter and exit ports (see above).
+ * @param vm the VM
+ * @param base the address of the first port
+ * @param out where console output goes
+ * @return 1 on success, 0 if the devices couldn't be mapped
+ */
+int mapStandardDevices(SsamVm *vm, unsigned short base, FILE *out);
+
+/**
+ * Flags every page holding a device. Called again after the VM's page flags are reset.
+ * @param vm the VM
+ */
+void markDevicePages(SsamVm *vm);
+
+/**
+ * Loads a word from whichever device address belongs to. Called by getWord().
+ * @param vm the VM
+ * @param address the address of the word
+ * @return the word
+ */
+unsigned short deviceRead(SsamVm *vm, unsigned short address);
+
+/**
+ * Passes a stored word to whichever device address belongs to. Called by setWord()
+ * after the word is written to memory.
+ * @param vm the VM
+ * @param address the address of the word
+ * @param value the word stored
+ */
+void deviceWrite(SsamVm *vm, unsigned short address, unsigned short value);
+
+/**
+ * Writes out any buffered console output.
+ * @param vm the VM
+ */
+void flushDevices(SsamVm *vm);
+
+/**
+ * Flushes and unmaps every device.
+ * @param vm the VM
+ */
+void destroyDevices(SsamVm *vm);
+
+#endif //DEVICE_H
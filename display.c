@@ -0,0 +1,201 @@
+// Bounded views of a VM's state for the d and N commands: a window around the stack and
+// PC, or just what changed since the last dump.
+// Created by Jackson Eshbaugh on 16.10.2026.
+
+#include "display.h"
+#include "controller.h"
+#include "memory.h"
+#include "format.h"
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WINDOW_BYTES (2 * DISPLAY_WINDOW_WORDS)
+#define WINDOW_ROWS (2 * DISPLAY_WINDOW_WORDS + 1)
+#define GAP_ROW (-1)
+
+static const char *registerNames[] = {"R0", "R1", "R2", "R3", "AC", "SP", "BP", "PC", "IR"};
+
+StateDisplay *createDisplay(DisplayMode mode) {
+    StateDisplay *display = calloc(1, sizeof(StateDisplay));
+    if (display) display->mode = mode;
+    return display;
+}
+
+void destroyDisplay(StateDisplay *display) {
+    free(display);
+}
+
+int parseDisplayMode(const char *name, DisplayMode *mode) {
+    if (strcmp(name, "full") == 0) *mode = DISPLAY_FULL;
+    else if (strcmp(name, "window") == 0) *mode = DISPLAY_WINDOW;
+    else if (strcmp(name, "delta") == 0) *mode = DISPLAY_DELTA;
+    else return 0;
+    return 1;
+}
+
+/**
+ * Appends formatted text to the display's buffer. Text that doesn't fit is cut off.
+ * @param display the display
+ * @param format the printf format
+ */
+void appendText(StateDisplay *display, const char *format, ...) {
+    size_t space = DISPLAY_BUFFER_SIZE - display->length;
+    if (space <= 1) return;
+
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(display->text + display->length, space, format, args);
+    va_end(args);
+    if (written < 0) return;
+    display->length += (size_t) written < space ? (size_t) written : space - 1;
+}
+
+/**
+ * Appends the status lines the table starts with (see formatStatus()).
+ * @param display the display
+ * @param vm the VM
+ * @param running what to append if there are none
+ */
+void appendStatus(StateDisplay *display, SsamVm *vm, const char *running) {
+    char status[STATE_STATUS_SIZE];
+    if (formatStatus(vm, status, sizeof(status)) > 0) appendText(display, "%s", status);
+    else appendText(display, "%s", running);
+}
+
+/**
+ * Lists the addresses of the words either side of address, clamped to memory.
+ * @param address the address in the middle
+ * @param rows where to put the addresses
+ * @return how many there are
+ */
+int windowRows(int address, int *rows) {
+    int start = address < WINDOW_BYTES ? address % 2 : address - WINDOW_BYTES;
+    int end = address + WINDOW_BYTES > MEMORY_SIZE - 2 ? MEMORY_SIZE - 2 : address + WINDOW_BYTES;
+    int count = 0;
+    for (int row = start; row <= end; row += 2) rows[count++] = row;
+    return count;
+}
+
+/**
+ * Lists the stack rows for the window: the words around BP and SP, as one run if they
+ * meet, or two runs with a gap between.
+ * @param vm the VM
+ * @param rows where to put the addresses, with GAP_ROW for the gap
+ * @return how many there are
+ */
+int stackRows(SsamVm *vm, int *rows) {
+    int low = getRegister(vm, BP), high = getRegister(vm, SP);
+    if (low > high) {
+        int swap = low;
+        low = high;
+        high = swap;
+    }
+
+    int count = windowRows(low, rows);
+    if (high == low) return count;
+    if ((high - low) % 2 == 0 && high - low <= 2 * WINDOW_BYTES + 2) {
+        // Close enough to run straight on from the low window
+        int end = high + WINDOW_BYTES > MEMORY_SIZE - 2 ? MEMORY_SIZE - 2 : high + WINDOW_BYTES;
+        for (int row = rows[count - 1] + 2; row <= end; row += 2) rows[count++] = row;
+        return count;
+    }
+    rows[count++] = GAP_ROW;
+    return count + windowRows(high, rows + count);
+}
+
+/**
+ * Builds the window view: the registers, the words around BP and SP, and the words around
+ * PC, in the same columns as the full table.
+ * @param display the display
+ * @param vm the VM
+ */
+void formatWindow(StateDisplay *display, SsamVm *vm) {
+    int stack[2 * WINDOW_ROWS + 1], program[WINDOW_ROWS];
+    int stackCount = stackRows(vm, stack);
+    int programCount = windowRows(getRegister(vm, PC), program);
+    int rowCount = stackCount > REG_COUNT ? stackCount : REG_COUNT;
+    if (programCount > rowCount) rowCount = programCount;
+
+    appendStatus(display, vm, "");
+    appendText(display, " REGISTERS                MEMORY                PROGRAM MEMORY\n");
+    appendText(display, "----------------------------------------------------------------------\n");
+    for (int i = 0; i < rowCount; i++) {
+        if (i < REG_COUNT) appendText(display, "%-3s: 0x%04hx          ", registerNames[i], getRegister(vm, i));
+        else appendText(display, "                     ");
+
+        if (i < stackCount && stack[i] == GAP_ROW) {
+            appendText(display, "  ...                      ");
+        } else if (i < stackCount) {
+            unsigned short address = stack[i];
+            const char *marker = "             ";
+            if (address == getRegister(vm, SP)) marker = "  [SP]       ";
+            else if (address == getRegister(vm, BP)) marker = "  [BP]       ";
+            appendText(display, "0x%04hx: 0x%04hx%s", address, getWord(vm, address), marker);
+        } else {
+            appendText(display, "                           ");
+        }
+
+        if (i < programCount) {
+            unsigned short address = program[i];
+            appendText(display, "0x%04hx: 0x%04hx%s", address, getWord(vm, address),
+                       address == getRegister(vm, PC) ? "  <== PC" : "");
+        }
+        appendText(display, "\n");
+    }
+}
+
+/**
+ * Builds the delta view: each register, flag and word of memory that changed since the
+ * last dump, with its old value. Device pages are left out, since reading them could
+ * change what the program sees.
+ * @param display the display
+ * @param vm the VM
+ */
+void formatDelta(StateDisplay *display, SsamVm *vm) {
+    int changes = 0;
+    if (vm->flags != display->flags || vm->stopped != display->stopped) {
+        appendStatus(display, vm, "[RUNNING]\n\n");
+        changes++;
+    }
+    for (int r = 0; r < REG_COUNT; r++) {
+        if (vm->R[r] == display->R[r]) continue;
+        appendText(display, "%-3s: 0x%04hx (was 0x%04hx)\n", registerNames[r], vm->R[r], display->R[r]);
+        changes++;
+    }
+
+    const unsigned char *memory = getMemory(vm);
+    int words = 0;
+    for (int page = 0; page < PAGE_COUNT; page++) {
+        int base = page << PAGE_SHIFT;
+        if (vm->pageFlags[page] & PAGE_DEVICE) continue;
+        if (memcmp(memory + base, display->memory + base, PAGE_BYTES) == 0) continue;
+
+        for (int address = base; address < base + PAGE_BYTES; address += 2) {
+            if (memory[address] == display->memory[address] && memory[address + 1] == display->memory[address + 1]) continue;
+            if (words++ < DISPLAY_DELTA_MAX) {
+                appendText(display, "0x%04hx: 0x%04hx (was 0x%04hx)\n", address,
+                           memory[address] << 8 | memory[address + 1],
+                           display->memory[address] << 8 | display->memory[address + 1]);
+            }
+        }
+    }
+    if (words > DISPLAY_DELTA_MAX) appendText(display, "... and %d more words\n", words - DISPLAY_DELTA_MAX);
+    if (changes + words == 0) appendText(display, "No changes.\n");
+}
+
+void rememberState(StateDisplay *display, SsamVm *vm) {
+    memcpy(display->R, vm->R, sizeof(display->R));
+    display->flags = vm->flags;
+    display->stopped = vm->stopped;
+    memcpy(display->memory, getMemory(vm), MEMORY_SIZE);
+    display->primed = 1;
+}
+
+void showState(StateDisplay *display, SsamVm *vm, FILE *out) {
+    display->length = 0;
+    if (display->mode == DISPLAY_DELTA && display->primed) formatDelta(display, vm);
+    else formatWindow(display, vm);
+    rememberState(display, vm);
+    fwrite(display->text, 1, display->length, out);
+}
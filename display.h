@@ -0,0 +1,76 @@
+// Bounded views of a VM's state for the d and N commands: a window around the stack and
+// PC, or just what changed since the last dump.
+// Created by Jackson Eshbaugh on 16.10.2026.
+
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include "vm.h"
+#include <stdio.h>
+
+#define DISPLAY_WINDOW_WORDS 4 // words shown either side of SP, BP and PC
+#define DISPLAY_DELTA_MAX 64 // changed words listed by one delta dump
+#define DISPLAY_BUFFER_SIZE 8192
+
+/**
+ * How d and N show the state.
+ */
+typedef enum {
+    DISPLAY_FULL, // the whole table, as logged by Q
+    DISPLAY_WINDOW, // the registers, and a few words around SP, BP and PC
+    DISPLAY_DELTA // the registers, flags and words that changed since the last dump
+} DisplayMode;
+
+/**
+ * A display's mode, its output buffer, and a copy of the state it last showed.
+ */
+typedef struct StateDisplay {
+    DisplayMode mode;
+    char text[DISPLAY_BUFFER_SIZE]; // each dump is built here, then written in one call
+    size_t length;
+    int primed; // whether the copy below holds a dump yet
+    unsigned short R[REG_COUNT];
+    char flags;
+    unsigned char stopped;
+    unsigned char memory[MEMORY_SIZE];
+} StateDisplay;
+
+/**
+ * Creates a display.
+ * @param mode how it shows the state
+ * @return the display, or NULL if it could not be allocated
+ */
+StateDisplay *createDisplay(DisplayMode mode);
+
+/**
+ * Frees a display.
+ * @param display the display
+ */
+void destroyDisplay(StateDisplay *display);
+
+/**
+ * Looks up a display mode by name: "full", "window" or "delta".
+ * @param name the name
+ * @param mode set to the mode named
+ * @return 1 if the name is a mode, 0 if not
+ */
+int parseDisplayMode(const char *name, DisplayMode *mode);
+
+/**
+ * Shows the VM's state in the display's window or delta mode, in a single write. The
+ * first delta dump, with nothing to compare against, shows the window instead.
+ * @param display the display
+ * @param vm the VM
+ * @param out the file to write to
+ */
+void showState(StateDisplay *display, SsamVm *vm, FILE *out);
+
+/**
+ * Remembers the VM's state as the last one shown, for the next delta dump. showState()
+ * does this itself; call it after showing the state some other way.
+ * @param display the display
+ * @param vm the VM
+ */
+void rememberState(StateDisplay *display, SsamVm *vm);
+
+#endif //DISPLAY_H
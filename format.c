@@ -0,0 +1,189 @@
+// Writes a VM's state as the text table, as JSON, or as a compact binary record.
+// Created by Jackson Eshbaugh on 16.10.2026.
+
+#include "format.h"
+#include "controller.h"
+#include "memory.h"
+#include "loop.h"
+#include <string.h>
+
+#define PROGRAM_ROWS 20 // program words shown by the table
+
+static const char *registerNames[] = {"R0", "R1", "R2", "R3", "AC", "SP", "BP", "PC", "IR"};
+
+int parseStateFormat(const char *name, StateFormat *format) {
+    if (strcmp(name, "text") == 0) *format = FORMAT_TEXT;
+    else if (strcmp(name, "json") == 0) *format = FORMAT_JSON;
+    else if (strcmp(name, "binary") == 0) *format = FORMAT_BINARY;
+    else return 0;
+    return 1;
+}
+
+int formatStatus(SsamVm *vm, char *buffer, size_t size) {
+    const char *flags = "";
+    if (errorOccurred(vm) && haltReached(vm)) flags = "[ERROR]      [HALT]\n\n";
+    else if (errorOccurred(vm)) flags = "[ERROR]\n\n";
+    else if (haltReached(vm)) flags = "[HALT]\n\n";
+
+    if (vm->stopped == STOP_BUDGET) return snprintf(buffer, size, "%s[BUDGET EXHAUSTED]\n\n", flags);
+    if (vm->stopped == STOP_TIMEOUT) return snprintf(buffer, size, "%s[TIMED OUT]\n\n", flags);
+    if (vm->stopped == STOP_LOOP) {
+        return snprintf(buffer, size, "%s[NON-TERMINATING]  PC: 0x%04hx-0x%04hx\n\n", flags, vm->loops->low,
+                        vm->loops->high);
+    }
+    return snprintf(buffer, size, "%s", flags);
+}
+
+/**
+ * Writes the state as the table: a row per word up to BP, with the registers, the stack
+ * from originalBP, and the program from originalPC side by side.
+ * @param vm the VM
+ * @param out the file to write to
+ * @param originalBP the first stack row
+ * @param originalPC the first program row
+ */
+void writeStateTable(SsamVm *vm, FILE *out, int originalBP, int originalPC) {
+    // Print error, halt and stop statuses
+    char status[STATE_STATUS_SIZE];
+    formatStatus(vm, status, sizeof(status));
+    fputs(status, out);
+
+    // Headers for table
+    fprintf(out, " REGISTERS                MEMORY                PROGRAM MEMORY\n");
+    fprintf(out, "----------------------------------------------------------------------\n");
+
+    short regCounter = 0;
+    int stackAddr = originalBP;
+    int progAddr = originalPC;
+
+    for (int i = 0; i < getRegister(vm, BP); i++) {
+        // Print registers
+        if (regCounter < REG_COUNT) {
+            fprintf(out, "%-3s: 0x%04hx          ", registerNames[regCounter], getRegister(vm, regCounter));
+            regCounter++;
+        } else {
+            fprintf(out, "                     "); // Empty space when there are no more registers to iterate through
+        }
+
+        // Print stack memory
+        fprintf(out, "0x%04hx: 0x%04hx", stackAddr, getWord(vm, stackAddr));
+        if (stackAddr == getRegister(vm, SP)) fprintf(out, "  [SP]       ");
+        else if (stackAddr == getRegister(vm, BP)) fprintf(out, "  [BP]       ");
+        else fprintf(out, "             ");
+
+        // Print program memory
+        if (progAddr < originalPC + 2 * PROGRAM_ROWS) {
+            fprintf(out, "0x%04hx: 0x%04hx", progAddr, getWord(vm, progAddr));
+            if (progAddr == getRegister(vm, PC)) fprintf(out, "  <== PC");
+        }
+
+        fprintf(out, "\n"); // New row
+        stackAddr += 2;
+        progAddr += 2;
+    }
+}
+
+/**
+ * Works out the memory a JSON or binary record includes, as start addresses and word
+ * counts: the layout's ranges, or the words the table would show.
+ * @param vm the VM
+ * @param layout the layout
+ * @param starts set to the address of each range
+ * @param counts set to the number of words in each range
+ * @return the number of ranges
+ */
+int stateRanges(SsamVm *vm, const StateLayout *layout, unsigned short *starts, int *counts) {
+    if (layout->rangeCount > 0) {
+        for (int i = 0; i < layout->rangeCount; i++) {
+            starts[i] = layout->ranges[i].start;
+            counts[i] = (unsigned short) (layout->ranges[i].end - layout->ranges[i].start) / 2 + 1;
+        }
+        return layout->rangeCount;
+    }
+
+    int rows = getRegister(vm, BP);
+    if (rows == 0) return 0;
+    starts[0] = layout->originalBP;
+    counts[0] = rows;
+    starts[1] = layout->originalPC;
+    counts[1] = rows < PROGRAM_ROWS ? rows : PROGRAM_ROWS;
+    return 2;
+}
+
+/**
+ * Writes the state as one line of JSON (see format.h).
+ * @param vm the VM
+ * @param out the file to write to
+ * @param layout the memory to include
+ */
+void writeStateJson(SsamVm *vm, FILE *out, const StateLayout *layout) {
+    const char *stopped = vm->stopped == STOP_BUDGET ? "\"budget\"" : vm->stopped == STOP_TIMEOUT ? "\"timeout\"" :
+                          vm->stopped == STOP_LOOP ? "\"loop\"" : "null";
+    fprintf(out, "{\"halt\":%s,\"error\":%s,\"stopped\":%s,", haltReached(vm) ? "true" : "false",
+            errorOccurred(vm) ? "true" : "false", stopped);
+    if (vm->stopped == STOP_LOOP) fprintf(out, "\"loop\":{\"low\":%hu,\"high\":%hu},", vm->loops->low, vm->loops->high);
+    fprintf(out, "\"registers\":{");
+    for (int r = 0; r < REG_COUNT; r++) {
+        fprintf(out, "%s\"%s\":%hu", r ? "," : "", registerNames[r], getRegister(vm, r));
+    }
+    fprintf(out, "},\"memory\":[");
+
+    unsigned short starts[STATE_RANGES_MAX];
+    int counts[STATE_RANGES_MAX];
+    int rangeCount = stateRanges(vm, layout, starts, counts);
+    for (int i = 0; i < rangeCount; i++) {
+        fprintf(out, "%s{\"start\":%hu,\"words\":[", i ? "," : "", starts[i]);
+        for (int w = 0; w < counts[i]; w++) {
+            fprintf(out, "%s%hu", w ? "," : "", getWord(vm, starts[i] + 2 * w));
+        }
+        fprintf(out, "]}");
+    }
+    fprintf(out, "]}\n");
+}
+
+/**
+ * Writes a word big-endian.
+ * @param out the file to write to
+ * @param word the word
+ */
+void writeStateWord(FILE *out, unsigned short word) {
+    fputc(word >> 8, out);
+    fputc(word & 0xFF, out);
+}
+
+/**
+ * Writes the state as a binary record (see format.h).
+ * @param vm the VM
+ * @param out the file to write to
+ * @param layout the memory to include
+ */
+void writeStateBinary(SsamVm *vm, FILE *out, const StateLayout *layout) {
+    fwrite(STATE_MAGIC, 1, 4, out);
+    fputc(STATE_VERSION, out);
+    fputc(vm->flags | vm->stopped << 2, out);
+    for (int r = 0; r < REG_COUNT; r++) writeStateWord(out, getRegister(vm, r));
+
+    unsigned short starts[STATE_RANGES_MAX];
+    int counts[STATE_RANGES_MAX];
+    int rangeCount = stateRanges(vm, layout, starts, counts);
+    writeStateWord(out, rangeCount);
+    for (int i = 0; i < rangeCount; i++) {
+        writeStateWord(out, starts[i]);
+        writeStateWord(out, counts[i]);
+        for (int w = 0; w < counts[i]; w++) writeStateWord(out, getWord(vm, starts[i] + 2 * w));
+    }
+}
+
+void writeState(SsamVm *vm, FILE *out, const StateLayout *layout) {
+    switch (layout->format) {
+        case FORMAT_TEXT:
+            writeStateTable(vm, out, layout->originalBP, layout->originalPC);
+            break;
+        case FORMAT_JSON:
+            writeStateJson(vm, out, layout);
+            break;
+        case FORMAT_BINARY:
+            writeStateBinary(vm, out, layout);
+            break;
+    }
+}
@@ -0,0 +1,90 @@
+// Writes a VM's state as the text table, as JSON, or as a compact binary record.
+// Created by Jackson Eshbaugh on 16.10.2026.
+//
+// The JSON form is one line:
+//
+//     {"halt":true,"error":false,"stopped":null,"registers":{"R0":0,...,"IR":0},
+//      "memory":[{"start":254,"words":[0,1,...]},...]}
+//
+// "stopped" is "budget" or "timeout" if a limit stopped the last limited run (see
+// runLimited() in controller.h), "loop" if it was found in a loop it can never leave, and
+// null otherwise. With "loop", a "loop" object follows, giving the lowest and highest
+// addresses the loop runs: {"low":1024,"high":1034}.
+//
+// The binary form is, all big-endian:
+// - the magic bytes "SSST" and a version byte (1)
+// - the flags byte (bit 0 halt, bit 1 error, and in bits 2 and 3 the STOP_* value from
+//   vm.h), then the registers R0 through IR, one word each
+// - a word giving the number of memory ranges, then for each range its start address, the
+//   number of words in it, and the words
+
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#include "vm.h"
+#include <stdio.h>
+
+#define STATE_MAGIC "SSST"
+#define STATE_VERSION 1
+#define STATE_RANGES_MAX 8
+#define STATE_STATUS_SIZE 64 // room for the longest status lines, and the terminator
+
+/**
+ * The forms the state can be written in.
+ */
+typedef enum {
+    FORMAT_TEXT, // the table printed by d and logged by Q
+    FORMAT_JSON,
+    FORMAT_BINARY
+} StateFormat;
+
+/**
+ * A run of words to include in the state, from start up to and including end.
+ */
+typedef struct {
+    unsigned short start;
+    unsigned short end;
+} MemoryRange;
+
+/**
+ * What to write: the form, where the run started, and which memory to include.
+ */
+typedef struct {
+    StateFormat format;
+    int originalBP; // the first stack row of the table
+    int originalPC; // the first program row of the table
+    // The memory JSON and binary records include. With none, they include the words the
+    // table shows: one stack word per row from originalBP, and the program words.
+    MemoryRange ranges[STATE_RANGES_MAX];
+    int rangeCount;
+} StateLayout;
+
+/**
+ * Looks up a format by name: "text", "json" or "binary".
+ * @param name the name
+ * @param format set to the format named
+ * @return 1 if the name is a format, 0 if not
+ */
+int parseStateFormat(const char *name, StateFormat *format);
+
+/**
+ * Formats the status lines the table starts with: the error and halt flags, if either is
+ * set, and what stopped the last limited run short of a halt (see runLimited() in
+ * controller.h), if anything did. Every view of the state that shows them uses this.
+ * @param vm the VM
+ * @param buffer where to put the lines, as a string; empty if there are none
+ * @param size the size of buffer (STATE_STATUS_SIZE is always enough)
+ * @return the length of the lines
+ */
+int formatStatus(SsamVm *vm, char *buffer, size_t size);
+
+/**
+ * Writes the VM's registers, flags and memory in the layout's format. This is the one
+ * formatter behind printState() and logState().
+ * @param vm the VM
+ * @param out the file to write to
+ * @param layout the format, and the memory to include
+ */
+void writeState(SsamVm *vm, FILE *out, const StateLayout *layout);
+
+#endif //FORMAT_H
@@ -0,0 +1,99 @@
+// Reads program images (.bin files) into a 64 KiB memory array.
+// Created by Jackson Eshbaugh on 16.10.2026.
+
+#include "image.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SEGMENT_HEADER_SIZE 6 // magic, then the segment count
+#define SEGMENT_ENTRY_SIZE 4 // load address, then length
+
+/**
+ * Copies the segments of a segmented image into memory.
+ * @param data the whole image
+ * @param size the size of the image in bytes
+ * @param memory the memory to load into
+ * @return one past the highest address loaded, or -1 if the image is malformed
+ */
+int loadSegments(const unsigned char *data, size_t size, unsigned char *memory) {
+    int count = data[4] << 8 | data[5];
+    size_t offset = SEGMENT_HEADER_SIZE;
+    int end = 0;
+
+    for (int i = 0; i < count; i++) {
+        if (size - offset < SEGMENT_ENTRY_SIZE) {
+            fprintf(stderr, "Error: segment %d of the image is cut off.\n", i);
+            return -1;
+        }
+        int address = data[offset] << 8 | data[offset + 1];
+        int length = data[offset + 2] << 8 | data[offset + 3];
+        offset += SEGMENT_ENTRY_SIZE;
+
+        if (size - offset < (size_t) length || address + length > IMAGE_MEMORY_SIZE) {
+            fprintf(stderr, "Error: segment %d of the image (0x%04x, %d bytes) doesn't fit.\n", i, address, length);
+            return -1;
+        }
+        memcpy(memory + address, data + offset, length);
+        offset += length;
+        if (address + length > end) end = address + length;
+    }
+    return end;
+}
+
+/**
+ * Loads an image that is already in host memory.
+ * @param data the whole image
+ * @param size the size of the image in bytes
+ * @param memory the memory to load into
+ * @return one past the highest address loaded, or -1 if the image is malformed
+ */
+int loadImageData(const unsigned char *data, size_t size, unsigned char *memory) {
+    if (size >= SEGMENT_HEADER_SIZE && memcmp(data, SEGMENT_MAGIC, 4) == 0) {
+        return loadSegments(data, size, memory);
+    }
+
+    // A flat image; anything past the end of memory can't be addressed
+    if (size > IMAGE_MEMORY_SIZE) {
+        fprintf(stderr, "Warning: the image is %zu bytes; only the first %d are loaded.\n", size, IMAGE_MEMORY_SIZE);
+        size = IMAGE_MEMORY_SIZE;
+    }
+    memcpy(memory, data, size);
+    return (int) size;
+}
+
+int loadImage(FILE *file, unsigned char *memory) {
+    struct stat info;
+    if (fstat(fileno(file), &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void *data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+        if (data != MAP_FAILED) {
+            int end = loadImageData(data, info.st_size, memory);
+            munmap(data, info.st_size);
+            return end;
+        }
+    }
+
+    // Not a regular file (or it couldn't be mapped): read it all in one go
+    size_t capacity = IMAGE_MEMORY_SIZE + 1, size = 0;
+    unsigned char *data = malloc(capacity);
+    if (!data) return -1;
+    size_t read;
+    while ((read = fread(data + size, 1, capacity - size, file)) > 0) {
+        size += read;
+        if (size == capacity) {
+            unsigned char *larger = realloc(data, capacity * 2);
+            if (!larger) break;
+            data = larger;
+            capacity *= 2;
+        }
+    }
+    if (ferror(file)) {
+        fprintf(stderr, "Error reading file at size %zu.\n", size);
+        free(data);
+        return -1;
+    }
+    int end = loadImageData(data, size, memory);
+    free(data);
+    return end;
+}
@@ -0,0 +1,27 @@
+// Reads program images (.bin files) into a 64 KiB memory array.
+// Created by Jackson Eshbaugh on 16.10.2026.
+//
+// Two formats are accepted:
+// - a flat image: the file's bytes are loaded starting at address 0x0000.
+// - a segmented image, for sparse programs: the magic bytes "SSEG", a big-endian word
+//   giving the number of segments, then for each segment a big-endian load address, a
+//   big-endian length, and that many bytes. Memory outside the segments is left alone.
+
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stdio.h>
+
+#define IMAGE_MEMORY_SIZE 0x10000
+#define SEGMENT_MAGIC "SSEG"
+
+/**
+ * Loads an image into memory. The file is mapped rather than read where possible, so
+ * each byte is copied once, straight into memory.
+ * @param file the image file, positioned at its start
+ * @param memory the IMAGE_MEMORY_SIZE bytes of memory to load into
+ * @return one past the highest address loaded, or -1 if the image couldn't be read
+ */
+int loadImage(FILE *file, unsigned char *memory);
+
+#endif //IMAGE_H
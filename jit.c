@@ -0,0 +1,573 @@
+// Basic-block JIT compiler from SSAM to x86-64.
+// Created by Jackson Eshbaugh on 16.10.2026.
+//
+// A block is a run of instructions ending at jmp/jmpz/jmpn/call/ret, at an instruction
+// the JIT doesn't translate (halt, errors, and anything addressing PC as a register), or
+// after MAX_BLOCK_LENGTH instructions. Generated code works directly on the register
+// file and memory:
+//   rbx = register file, r12 = memory, r13 = remaining step budget, r14 = the VM,
+//   r15 = &budget
+// Every block starts by charging its length to the budget. Blocks leave by storing PC
+// and IR, then jumping through blockTable[PC], which holds either the native code for
+// the block at PC or the exit stub that returns to C. That makes chaining free and lets
+// a block be flushed by resetting a single table entry.
+
+#include "jit.h"
+
+#include "decode.h"
+#include "memory.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define CODE_SIZE (256 * 1024)
+#define MAX_BLOCK_LENGTH 64
+#define MAX_INSTRUCTION_SIZE 96 // upper bound on the native code for one instruction
+#define MAX_BLOCKS 4096
+#define ADDRESS_COUNT 0x10000
+
+#define BLOCK_UNKNOWN 0
+#define BLOCK_COMPILED 1
+#define BLOCK_INTERPRET 2
+
+#define REG_OFFSET(reg) ((reg) * 2)
+
+typedef void (*JitEntry)(unsigned short *regs, unsigned char *memory, long *budget, void *code, SsamVm *vm);
+
+typedef struct {
+    unsigned short start; // address of the first instruction
+    unsigned short length; // bytes of guest code covered
+} JitBlock;
+
+struct JitState {
+    int available; // 1 if the code buffer could be mapped
+    unsigned char *code; // executable buffer
+    unsigned char *codeNext; // where the next block is emitted
+    unsigned char *codeStart; // first byte after the entry trampoline and exit stub
+    JitEntry enter;
+    void *exitStub;
+
+    void *blockTable[ADDRESS_COUNT]; // native entry point for each guest address, or exitStub
+    unsigned char blockState[ADDRESS_COUNT]; // BLOCK_* for each guest address
+    unsigned char blockSteps[ADDRESS_COUNT]; // instructions in the block starting at each guest address
+    unsigned char covered[ADDRESS_COUNT]; // number of blocks covering each guest byte
+    JitBlock blocks[MAX_BLOCKS];
+    int blockCount;
+
+    int flushed; // set when a store flushes a block; reset each time native code is entered
+};
+
+// code emission
+
+void emit8(JitState *jit, unsigned char byte) {
+    *jit->codeNext++ = byte;
+}
+
+void emit16(JitState *jit, unsigned short value) {
+    memcpy(jit->codeNext, &value, 2);
+    jit->codeNext += 2;
+}
+
+void emit32(JitState *jit, unsigned int value) {
+    memcpy(jit->codeNext, &value, 4);
+    jit->codeNext += 4;
+}
+
+void emit64(JitState *jit, unsigned long long value) {
+    memcpy(jit->codeNext, &value, 8);
+    jit->codeNext += 8;
+}
+
+/**
+ * Emits a rel32 operand that makes the preceding jump land on target.
+ * @param target the address to jump to
+ */
+void emitRel32(JitState *jit, void *target) {
+    emit32(jit, (unsigned int) ((unsigned char *) target - (jit->codeNext + 4)));
+}
+
+/**
+ * movzx <dest>, word [rbx + REG_OFFSET(reg)]
+ * @param modrmReg the ModRM reg field of the destination (0 = eax, 1 = ecx, 2 = edx, 6 = esi)
+ * @param reg the guest register to load
+ */
+void emitLoadRegister(JitState *jit, unsigned char modrmReg, Register reg) {
+    emit8(jit, 0x0f); emit8(jit, 0xb7); emit8(jit, 0x43 | (modrmReg << 3)); emit8(jit, REG_OFFSET(reg));
+}
+
+/**
+ * mov word [rbx + REG_OFFSET(reg)], ax (or cx)
+ * @param modrmReg 0 to store ax, 1 to store cx
+ * @param reg the guest register to write
+ */
+void emitStoreRegister(JitState *jit, unsigned char modrmReg, Register reg) {
+    emit8(jit, 0x66); emit8(jit, 0x89); emit8(jit, 0x43 | (modrmReg << 3)); emit8(jit, REG_OFFSET(reg));
+}
+
+/**
+ * mov word [rbx + REG_OFFSET(reg)], value
+ * @param reg the guest register to write
+ * @param value the value to write
+ */
+void emitSetRegister(JitState *jit, Register reg, unsigned short value) {
+    emit8(jit, 0x66); emit8(jit, 0xc7); emit8(jit, 0x43); emit8(jit, REG_OFFSET(reg)); emit16(jit, value);
+}
+
+/**
+ * ecx <== M[address], for a constant address.
+ * @param address the address of the word to load
+ */
+void emitLoadWordConstant(JitState *jit, unsigned short address) {
+    emit8(jit, 0x41); emit8(jit, 0x0f); emit8(jit, 0xb6); emit8(jit, 0x8c); emit8(jit, 0x24); emit32(jit, address);
+    emit8(jit, 0x41); emit8(jit, 0x0f); emit8(jit, 0xb6); emit8(jit, 0x94); emit8(jit, 0x24); emit32(jit, (unsigned short) (address + 1));
+    emit8(jit, 0xc1); emit8(jit, 0xe1); emit8(jit, 0x08); // shl ecx, 8
+    emit8(jit, 0x09); emit8(jit, 0xd1); // or ecx, edx
+}
+
+/**
+ * ecx <== M[eax], where eax holds a 16-bit address.
+ */
+void emitLoadWordDynamic(JitState *jit) {
+    emit8(jit, 0x41); emit8(jit, 0x0f); emit8(jit, 0xb6); emit8(jit, 0x0c); emit8(jit, 0x04); // movzx ecx, byte [r12 + rax]
+    emit8(jit, 0x8d); emit8(jit, 0x50); emit8(jit, 0x01); // lea edx, [rax + 1]
+    emit8(jit, 0x0f); emit8(jit, 0xb7); emit8(jit, 0xd2); // movzx edx, dx
+    emit8(jit, 0x41); emit8(jit, 0x0f); emit8(jit, 0xb6); emit8(jit, 0x14); emit8(jit, 0x14); // movzx edx, byte [r12 + rdx]
+    emit8(jit, 0xc1); emit8(jit, 0xe1); emit8(jit, 0x08); // shl ecx, 8
+    emit8(jit, 0x09); emit8(jit, 0xd1); // or ecx, edx
+}
+
+/**
+ * call function(vm, esi, edx) (clobbers rax)
+ * @param function the function to call
+ */
+void emitCall(JitState *jit, void *function) {
+    emit8(jit, 0x4c); emit8(jit, 0x89); emit8(jit, 0xf7); // mov rdi, r14
+    emit8(jit, 0x48); emit8(jit, 0xb8); emit64(jit, (unsigned long long) function); // mov rax, function
+    emit8(jit, 0xff); emit8(jit, 0xd0); // call rax
+}
+
+/**
+ * Leaves the block for address, through the block table.
+ * @param address the guest address to continue at
+ */
+void emitChain(JitState *jit, unsigned short address) {
+    emitSetRegister(jit, PC, address);
+    emit8(jit, 0x48); emit8(jit, 0xb8); emit64(jit, (unsigned long long) &jit->blockTable[address]); // mov rax, &jit->blockTable[address]
+    emit8(jit, 0xff); emit8(jit, 0x20); // jmp [rax]
+}
+
+/**
+ * Leaves the block after a store jit->flushed translated code. The rest of the block is not
+ * run, so its steps are given back to the budget.
+ * @param next the address of the next instruction
+ * @param refund the number of instructions in the block that didn't run
+ */
+void emitFlushCheck(JitState *jit, unsigned short next, unsigned int refund) {
+    emit8(jit, 0x85); emit8(jit, 0xc0); // test eax, eax
+    emit8(jit, 0x74); // jz over the exit
+    unsigned char *skip = jit->codeNext;
+    emit8(jit, 0x00);
+    emitSetRegister(jit, PC, next);
+    emit8(jit, 0x49); emit8(jit, 0x81); emit8(jit, 0xc5); emit32(jit, refund); // add r13, refund
+    emit8(jit, 0xe9); emitRel32(jit, jit->exitStub);
+    *skip = (unsigned char) (jit->codeNext - skip - 1);
+}
+
+// runtime helpers called from native code
+
+/**
+ * Stores a word on behalf of native code.
+ * @param vm the VM
+ * @param address the address to store at
+ * @param value the word to store
+ * @return nonzero if any translated code was flushed since native code was entered
+ */
+int jitStoreWord(SsamVm *vm, unsigned int address, unsigned int value) {
+    setWord(vm, (unsigned short) address, (unsigned short) value);
+    return vm->jit->flushed;
+}
+
+// block management
+
+/**
+ * Determines if the JIT translates an instruction. Halts and errors are left to the
+ * interpreter, and so is anything that reads or writes PC as a general register.
+ * @param instruction the decoded instruction
+ * @return 1 if the instruction can be translated, 0 otherwise
+ */
+int translatable(DecodedInstruction *instruction) {
+    switch (instruction->op) {
+        case OP_NOP:
+        case OP_RET:
+        case OP_JMP:
+        case OP_JMPZ:
+        case OP_JMPN:
+        case OP_CALL:
+            return 1;
+        case OP_LODI:
+        case OP_LODA:
+        case OP_LODR:
+        case OP_STOA:
+        case OP_NEG:
+        case OP_ADDI:
+        case OP_SUBI:
+            return instruction->regA != PC;
+        case OP_LODRD:
+        case OP_STOR:
+        case OP_STORD:
+        case OP_ADDR:
+        case OP_SUBR:
+        case OP_MOV:
+            return instruction->regA != PC && instruction->regB != PC;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Removes a block, unlinking it from every block that chains to it.
+ * @param jit the JIT state
+ * @param index the index of the block in blocks
+ */
+void removeBlock(JitState *jit, int index) {
+    JitBlock *block = &jit->blocks[index];
+    jit->blockTable[block->start] = jit->exitStub;
+    jit->blockState[block->start] = BLOCK_UNKNOWN;
+    for (int i = 0; i < block->length; i++) {
+        jit->covered[(unsigned short) (block->start + i)]--;
+    }
+    jit->blocks[index] = jit->blocks[--jit->blockCount];
+}
+
+void jitReset(SsamVm *vm) {
+    JitState *jit = vm->jit;
+    if (!jit || !jit->available) return;
+    for (int i = 0; i < ADDRESS_COUNT; i++) {
+        jit->blockTable[i] = jit->exitStub;
+    }
+    memset(jit->blockState, BLOCK_UNKNOWN, ADDRESS_COUNT);
+    memset(jit->covered, 0, ADDRESS_COUNT);
+    jit->blockCount = 0;
+    jit->codeNext = jit->codeStart;
+}
+
+void jitInvalidate(SsamVm *vm, unsigned short address) {
+    JitState *jit = vm->jit;
+    if (!jit || !jit->available) return;
+
+    unsigned short next = address + 1;
+    if (!jit->covered[address] && !jit->covered[next]) {
+        // Not translated code, but this may have been an instruction we chose to interpret
+        jit->blockState[address] = BLOCK_UNKNOWN;
+        jit->blockState[next] = BLOCK_UNKNOWN;
+        return;
+    }
+
+    for (int i = jit->blockCount - 1; i >= 0; i--) {
+        unsigned short offset = address - jit->blocks[i].start;
+        unsigned short nextOffset = next - jit->blocks[i].start;
+        if (offset < jit->blocks[i].length || nextOffset < jit->blocks[i].length) {
+            removeBlock(jit, i);
+        }
+    }
+    jit->blockState[address] = BLOCK_UNKNOWN;
+    jit->blockState[next] = BLOCK_UNKNOWN;
+    jit->flushed = 1;
+}
+
+/**
+ * Emits native code for one instruction.
+ * @param instruction the decoded instruction
+ * @param address the address of the instruction
+ * @param remaining the instructions left in the block after this one
+ */
+void translate(JitState *jit, DecodedInstruction *instruction, unsigned short address, int remaining) {
+    unsigned short next = address + 0x02;
+    Register a = instruction->regA;
+    Register b = instruction->regB;
+    unsigned char *skip;
+
+    switch (instruction->op) {
+        case OP_NOP:
+            break;
+        case OP_LODI:
+            emitSetRegister(jit, a, instruction->imm);
+            break;
+        case OP_LODA:
+            emitLoadWordConstant(jit, instruction->imm);
+            emitStoreRegister(jit, 1, a);
+            break;
+        case OP_LODR:
+            emitLoadWordConstant(jit, b); // same as lodr()
+            emitStoreRegister(jit, 1, a);
+            break;
+        case OP_LODRD:
+            emitLoadRegister(jit, 0, b);
+            emit8(jit, 0x05); emit32(jit, instruction->imm); // add eax, offset
+            emit8(jit, 0x0f); emit8(jit, 0xb7); emit8(jit, 0xc0); // movzx eax, ax
+            emitLoadWordDynamic(jit);
+            emitStoreRegister(jit, 1, a);
+            break;
+        case OP_STOA:
+            emit8(jit, 0xbe); emit32(jit, (unsigned short) instruction->imm); // mov esi, address
+            emitLoadRegister(jit, 2, a);
+            emitCall(jit, jitStoreWord);
+            emitSetRegister(jit, IR, instruction->word);
+            emitFlushCheck(jit, next, remaining);
+            break;
+        case OP_STOR:
+            emitLoadRegister(jit, 6, b);
+            emitLoadRegister(jit, 2, a);
+            emitCall(jit, jitStoreWord);
+            emitSetRegister(jit, IR, instruction->word);
+            emitFlushCheck(jit, next, remaining);
+            break;
+        case OP_STORD:
+            emitLoadRegister(jit, 6, b);
+            emit8(jit, 0x81); emit8(jit, 0xc6); emit32(jit, instruction->imm); // add esi, offset
+            emitLoadRegister(jit, 2, a);
+            emitCall(jit, jitStoreWord);
+            emitSetRegister(jit, IR, instruction->word);
+            emitFlushCheck(jit, next, remaining);
+            break;
+        case OP_NEG:
+            emitLoadRegister(jit, 0, a);
+            emit8(jit, 0xf7); emit8(jit, 0xd8); // neg eax
+            emitStoreRegister(jit, 0, AC);
+            break;
+        case OP_ADDR:
+            emitLoadRegister(jit, 0, a);
+            emitLoadRegister(jit, 1, b);
+            emit8(jit, 0x01); emit8(jit, 0xc8); // add eax, ecx
+            emitStoreRegister(jit, 0, AC);
+            break;
+        case OP_ADDI:
+            emitLoadRegister(jit, 0, a);
+            emit8(jit, 0x05); emit32(jit, instruction->imm); // add eax, immediate
+            emitStoreRegister(jit, 0, AC);
+            break;
+        case OP_SUBR:
+            emitLoadRegister(jit, 0, a);
+            emitLoadRegister(jit, 1, b);
+            emit8(jit, 0x29); emit8(jit, 0xc8); // sub eax, ecx
+            emitStoreRegister(jit, 0, AC);
+            break;
+        case OP_SUBI:
+            emitLoadRegister(jit, 0, a);
+            emit8(jit, 0x2d); emit32(jit, instruction->imm); // sub eax, immediate
+            emitStoreRegister(jit, 0, AC);
+            break;
+        case OP_MOV:
+            emitLoadRegister(jit, 0, b);
+            emitStoreRegister(jit, 0, a);
+            break;
+        case OP_JMP:
+            emitSetRegister(jit, IR, instruction->word);
+            emitChain(jit, instruction->imm);
+            break;
+        case OP_JMPZ:
+        case OP_JMPN:
+            emitSetRegister(jit, IR, instruction->word);
+            emit8(jit, 0x66); emit8(jit, 0x83); emit8(jit, 0x7b); emit8(jit, REG_OFFSET(AC)); emit8(jit, 0x00); // cmp word [AC], 0
+            emit8(jit, instruction->op == OP_JMPZ ? 0x74 : 0x7c); // je/jl over the not-taken exit
+            skip = jit->codeNext;
+            emit8(jit, 0x00);
+            emitChain(jit, next);
+            *skip = (unsigned char) (jit->codeNext - skip - 1);
+            emitChain(jit, instruction->imm);
+            break;
+        case OP_CALL:
+            // M[R[SP]] <== R[PC]
+            emitLoadRegister(jit, 6, SP);
+            emit8(jit, 0xba); emit32(jit, next); // mov edx, next
+            emitCall(jit, jitStoreWord);
+            // R[SP] <== R[SP] + 0x02
+            emitLoadRegister(jit, 0, SP);
+            emit8(jit, 0x05); emit32(jit, 0x02);
+            emitStoreRegister(jit, 0, SP);
+            // M[R[SP]] <== R[BP]
+            emit8(jit, 0x89); emit8(jit, 0xc6); // mov esi, eax
+            emitLoadRegister(jit, 2, BP);
+            emitCall(jit, jitStoreWord);
+            emit8(jit, 0x89); emit8(jit, 0xc1); // mov ecx, eax
+            // R[BP] <== R[SP]; R[SP] <== R[SP] + 0x02
+            emitLoadRegister(jit, 0, SP);
+            emitStoreRegister(jit, 0, BP);
+            emit8(jit, 0x05); emit32(jit, 0x02);
+            emitStoreRegister(jit, 0, SP);
+            emitSetRegister(jit, IR, instruction->word);
+            // Leave through the exit stub if either store jit->flushed translated code
+            emit8(jit, 0x85); emit8(jit, 0xc9); // test ecx, ecx
+            emit8(jit, 0x74); // jz over the exit
+            skip = jit->codeNext;
+            emit8(jit, 0x00);
+            emitSetRegister(jit, PC, instruction->imm);
+            emit8(jit, 0xe9); emitRel32(jit, jit->exitStub);
+            *skip = (unsigned char) (jit->codeNext - skip - 1);
+            emitChain(jit, instruction->imm);
+            break;
+        case OP_RET:
+            // R[SP] <== R[BP]; R[BP] <== M[R[SP]]
+            emitLoadRegister(jit, 0, BP);
+            emitStoreRegister(jit, 0, SP);
+            emitLoadWordDynamic(jit);
+            emitStoreRegister(jit, 1, BP);
+            // R[SP] <== R[SP] - 0x02; R[PC] <== M[R[SP]]
+            emitLoadRegister(jit, 0, SP);
+            emit8(jit, 0x2d); emit32(jit, 0x02);
+            emit8(jit, 0x0f); emit8(jit, 0xb7); emit8(jit, 0xc0); // movzx eax, ax
+            emitStoreRegister(jit, 0, SP);
+            emitLoadWordDynamic(jit);
+            emitStoreRegister(jit, 1, PC);
+            emitSetRegister(jit, IR, instruction->word);
+            emit8(jit, 0x0f); emit8(jit, 0xb7); emit8(jit, 0xc1); // movzx eax, cx
+            emit8(jit, 0x48); emit8(jit, 0xb9); emit64(jit, (unsigned long long) jit->blockTable); // mov rcx, jit->blockTable
+            emit8(jit, 0xff); emit8(jit, 0x24); emit8(jit, 0xc1); // jmp [rcx + rax * 8]
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * Translates the block starting at address, or marks the address to be interpreted if
+ * its first instruction can't be translated.
+ * @param vm the VM
+ * @param address the address of the first instruction in the block
+ */
+void compileBlock(SsamVm *vm, unsigned short address) {
+    JitState *jit = vm->jit;
+    DecodedInstruction instructions[MAX_BLOCK_LENGTH];
+    int count = 0;
+    int terminated = 0;
+
+    // Find the block
+    unsigned short cursor = address;
+    while (count < MAX_BLOCK_LENGTH && !terminated) {
+        DecodedInstruction *instruction = &instructions[count];
+        decodeInstruction(getWord(vm, cursor), instruction);
+        if (!translatable(instruction)) break;
+        instruction->tag = cursor;
+        count++;
+        cursor += 0x02;
+        terminated = instruction->op == OP_JMP || instruction->op == OP_JMPZ || instruction->op == OP_JMPN
+                     || instruction->op == OP_CALL || instruction->op == OP_RET;
+    }
+
+    if (count == 0) {
+        jit->blockState[address] = BLOCK_INTERPRET;
+        markCode(vm, address);
+        return;
+    }
+
+    if (jit->blockCount == MAX_BLOCKS || jit->code + CODE_SIZE - jit->codeNext < (count + 1) * MAX_INSTRUCTION_SIZE) {
+        jitReset(vm);
+    }
+
+    unsigned char *entry = jit->codeNext;
+
+    // Charge the whole block to the budget up front; leave if it doesn't fit
+    emit8(jit, 0x49); emit8(jit, 0x81); emit8(jit, 0xfd); emit32(jit, count); // cmp r13, count
+    emit8(jit, 0x0f); emit8(jit, 0x8c); emitRel32(jit, jit->exitStub); // jl exitStub
+    emit8(jit, 0x49); emit8(jit, 0x81); emit8(jit, 0xed); emit32(jit, count); // sub r13, count
+
+    for (int i = 0; i < count; i++) {
+        translate(jit, &instructions[i], instructions[i].tag, count - i - 1);
+    }
+    if (!terminated) {
+        // Fell off the end of the block
+        emitSetRegister(jit, IR, instructions[count - 1].word);
+        emitChain(jit, cursor);
+    }
+
+    JitBlock *block = &jit->blocks[jit->blockCount++];
+    block->start = address;
+    block->length = cursor - address;
+    for (int i = 0; i < block->length; i++) {
+        jit->covered[(unsigned short) (address + i)]++;
+    }
+    for (int i = 0; i < count; i++) {
+        markCode(vm, instructions[i].tag);
+    }
+
+    jit->blockTable[address] = entry;
+    jit->blockState[address] = BLOCK_COMPILED;
+    jit->blockSteps[address] = count;
+}
+
+int jitAvailable(SsamVm *vm) {
+    if (vm->jit) return vm->jit->available;
+
+    JitState *jit = calloc(1, sizeof(JitState));
+    if (!jit) return 0;
+    vm->jit = jit;
+
+    jit->code = mmap(0, CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (jit->code == MAP_FAILED) {
+        jit->code = NULL;
+        return 0;
+    }
+    jit->codeNext = jit->code;
+
+    // Entry trampoline: enter(regs, memory, &budget, nativeCode, vm)
+    jit->enter = (JitEntry) jit->codeNext;
+    emit8(jit, 0x53); // push rbx
+    emit8(jit, 0x41); emit8(jit, 0x54); // push r12
+    emit8(jit, 0x41); emit8(jit, 0x55); // push r13
+    emit8(jit, 0x41); emit8(jit, 0x56); // push r14
+    emit8(jit, 0x41); emit8(jit, 0x57); // push r15
+    emit8(jit, 0x48); emit8(jit, 0x89); emit8(jit, 0xfb); // mov rbx, rdi
+    emit8(jit, 0x49); emit8(jit, 0x89); emit8(jit, 0xf4); // mov r12, rsi
+    emit8(jit, 0x49); emit8(jit, 0x89); emit8(jit, 0xd7); // mov r15, rdx
+    emit8(jit, 0x4c); emit8(jit, 0x8b); emit8(jit, 0x2a); // mov r13, [rdx]
+    emit8(jit, 0x4d); emit8(jit, 0x89); emit8(jit, 0xc6); // mov r14, r8
+    emit8(jit, 0xff); emit8(jit, 0xe1); // jmp rcx
+
+    // Exit stub: write back the budget and return to C
+    jit->exitStub = jit->codeNext;
+    emit8(jit, 0x4d); emit8(jit, 0x89); emit8(jit, 0x2f); // mov [r15], r13
+    emit8(jit, 0x41); emit8(jit, 0x5f); // pop r15
+    emit8(jit, 0x41); emit8(jit, 0x5e); // pop r14
+    emit8(jit, 0x41); emit8(jit, 0x5d); // pop r13
+    emit8(jit, 0x41); emit8(jit, 0x5c); // pop r12
+    emit8(jit, 0x5b); // pop rbx
+    emit8(jit, 0xc3); // ret
+
+    jit->codeStart = jit->codeNext;
+    jit->available = 1;
+    jitReset(vm);
+    return 1;
+}
+
+void jitDestroy(SsamVm *vm) {
+    if (!vm->jit) return;
+    if (vm->jit->code) munmap(vm->jit->code, CODE_SIZE);
+    free(vm->jit);
+    vm->jit = NULL;
+}
+
+RunStatus jitRunUntil(SsamVm *vm, unsigned long maxSteps) {
+    JitState *jit = vm->jit;
+    long budget = maxSteps > LONG_MAX ? LONG_MAX : (long) maxSteps;
+
+    while (budget > 0) {
+        unsigned short pc = vm->R[PC];
+        if (jit->blockState[pc] == BLOCK_UNKNOWN) compileBlock(vm, pc);
+
+        if (jit->blockState[pc] == BLOCK_COMPILED && budget >= jit->blockSteps[pc]) {
+            // Run native code until it reaches something it can't chain to
+            long before = budget;
+            jit->flushed = 0;
+            jit->enter(vm->R, getMemory(vm), &budget, jit->blockTable[pc], vm);
+            vm->cycles += before - budget;
+            continue;
+        }
+
+        // Interpret one instruction
+        RunStatus status = interpret(vm, 1);
+        budget--;
+        if (status != RUN_BUDGET) return status;
+    }
+    return RUN_BUDGET;
+}
@@ -0,0 +1,47 @@
+// Basic-block JIT compiler from SSAM to x86-64.
+// Created by Jackson Eshbaugh on 16.10.2026.
+
+#ifndef JIT_H
+#define JIT_H
+
+#include "controller.h"
+
+/**
+ * Determines if the JIT can be used for a VM. The first call allocates the VM's
+ * executable code buffer and block tables.
+ * @param vm the VM
+ * @return 1 if native code can be generated and run, 0 otherwise
+ */
+int jitAvailable(SsamVm *vm);
+
+/**
+ * Frees the VM's translated code and JIT tables.
+ * @param vm the VM
+ */
+void jitDestroy(SsamVm *vm);
+
+/**
+ * Runs the program like runUntil(), translating basic blocks to native code as they are
+ * reached and chaining them together. Anything the JIT can't translate is run one
+ * instruction at a time by the interpreter.
+ *
+ * @param vm the VM
+ * @param maxSteps the most instructions to run
+ * @return why execution stopped
+ */
+RunStatus jitRunUntil(SsamVm *vm, unsigned long maxSteps);
+
+/**
+ * Flushes every translated block that covers the word at address.
+ * @param vm the VM
+ * @param address the address of the word that was written
+ */
+void jitInvalidate(SsamVm *vm, unsigned short address);
+
+/**
+ * Flushes all translated blocks.
+ * @param vm the VM
+ */
+void jitReset(SsamVm *vm);
+
+#endif //JIT_H
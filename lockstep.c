@@ -0,0 +1,393 @@
+// Runs one program on many VMs at once, one VM per SIMD lane.
+// Created by Jackson Eshbaugh on 16.10.2026.
+
+#include "lockstep.h"
+#include "controller.h"
+#include "memory.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LINE_SIZE 1024
+
+// Takes value in the lanes set in mask, and old everywhere else.
+#define SELECT(mask, value, old) (((value) & (mask)) | ((old) & ~(mask)))
+
+LockstepGroup *createLockstepGroup() {
+    LockstepGroup *group = aligned_alloc(_Alignof(LockstepGroup), sizeof(LockstepGroup));
+    if (!group) return NULL;
+    memset(group, 0, sizeof(LockstepGroup));
+    return group;
+}
+
+void destroyLockstepGroup(LockstepGroup *group) {
+    free(group);
+}
+
+void lockstepInit(LockstepGroup *group, const unsigned char *image, int laneCount, short sp, short pc) {
+    for (int i = 0; i < REG_COUNT; i++) group->R[i] = (LaneWords) {0};
+    group->R[SP] += (unsigned short) sp;
+    group->R[BP] += (unsigned short) (sp - 0x02);
+    group->R[PC] += (unsigned short) pc;
+    group->flags = (LaneWords) {0};
+    for (int lane = 0; lane < LANE_COUNT; lane++) group->live[lane] = lane < laneCount ? 0xffff : 0x0000;
+    group->firstLive = laneCount > 0 ? 0 : -1;
+
+    for (int address = 0; address < MEMORY_SIZE; address++) {
+        group->memory[address] = (LaneBytes) {0} + image[address];
+        group->decoded[address].valid = 0;
+    }
+}
+
+/**
+ * Forgets the decoded instructions that overlap the word at address.
+ * @param group the group
+ * @param address the address of the word that was written
+ */
+void lockstepInvalidate(LockstepGroup *group, unsigned short address) {
+    group->decoded[(unsigned short) (address - 1)].valid = 0;
+    group->decoded[address].valid = 0;
+    group->decoded[(unsigned short) (address + 1)].valid = 0;
+}
+
+void lockstepSetWord(LockstepGroup *group, int lane, unsigned short address, unsigned short value) {
+    group->memory[address][lane] = (value >> 8) & 0xFF;
+    group->memory[(unsigned short) (address + 1)][lane] = value & 0xFF;
+    lockstepInvalidate(group, address);
+}
+
+unsigned short lockstepGetWord(LockstepGroup *group, int lane, unsigned short address) {
+    return group->memory[address][lane] << 8 | group->memory[(unsigned short) (address + 1)][lane];
+}
+
+/**
+ * Determines if any lane of v is non-zero.
+ * @param v the vector to test
+ * @return 1 if any lane is non-zero, 0 otherwise
+ */
+int anyLane(const LaneWords *v) {
+    unsigned long long parts[sizeof(LaneWords) / sizeof(unsigned long long)];
+    unsigned long long any = 0;
+    memcpy(parts, v, sizeof(LaneWords));
+    for (int i = 0; i < (int) (sizeof(parts) / sizeof(parts[0])); i++) any |= parts[i];
+    return any != 0;
+}
+
+/**
+ * Loads a word into a register, in the lanes set in mask. When every lane reads the same
+ * address, this is two vector loads, since memory is laid out by lane; otherwise each
+ * lane is loaded on its own.
+ * @param group the group
+ * @param address the address to read from, for each lane
+ * @param mask the lanes to load
+ * @param leader a lane set in mask
+ * @param reg the register to load into
+ */
+void lockstepLoad(LockstepGroup *group, const LaneWords *address, const LaneWords *mask, int leader, LaneWords *reg) {
+    unsigned short shared = (*address)[leader];
+    LaneWords scattered = *mask & (LaneWords) (*address != shared);
+    if (!anyLane(&scattered)) {
+        LaneWords top = __builtin_convertvector(group->memory[shared], LaneWords);
+        LaneWords bottom = __builtin_convertvector(group->memory[(unsigned short) (shared + 1)], LaneWords);
+        *reg = SELECT(*mask, top << 8 | bottom, *reg);
+        return;
+    }
+    for (int lane = 0; lane < LANE_COUNT; lane++) {
+        if ((*mask)[lane]) (*reg)[lane] = lockstepGetWord(group, lane, (*address)[lane]);
+    }
+}
+
+/**
+ * Stores a word from a register, in the lanes set in mask. When every lane writes the
+ * same address, this is a pair of vector blends; otherwise each lane is stored on its own.
+ * @param group the group
+ * @param address the address to write to, for each lane
+ * @param value the word to write, for each lane
+ * @param mask the lanes to write
+ * @param leader a lane set in mask
+ */
+void lockstepStore(LockstepGroup *group, const LaneWords *address, const LaneWords *value, const LaneWords *mask, int leader) {
+    unsigned short shared = (*address)[leader];
+    LaneWords scattered = *mask & (LaneWords) (*address != shared);
+    if (!anyLane(&scattered)) {
+        LaneBytes byteMask = __builtin_convertvector(*mask, LaneBytes);
+        LaneBytes top = __builtin_convertvector(*value >> 8, LaneBytes);
+        LaneBytes bottom = __builtin_convertvector(*value, LaneBytes);
+        unsigned short next = shared + 1;
+        group->memory[shared] = SELECT(byteMask, top, group->memory[shared]);
+        group->memory[next] = SELECT(byteMask, bottom, group->memory[next]);
+        lockstepInvalidate(group, shared);
+        return;
+    }
+    for (int lane = 0; lane < LANE_COUNT; lane++) {
+        if ((*mask)[lane]) lockstepSetWord(group, lane, (*address)[lane], (*value)[lane]);
+    }
+}
+
+/**
+ * Runs one decoded instruction in the lanes set in mask, all lanes at once.
+ *
+ * @param group the group
+ * @param d the instruction
+ * @param lanes the lanes to run it in
+ * @param leader a lane set in lanes
+ */
+void lockstepExecute(LockstepGroup *group, const DecodedInstruction *d, const LaneWords *lanes, int leader) {
+    LaneWords *r = group->R;
+    LaneWords mask = *lanes;
+    LaneWords imm = (LaneWords) {0} + (unsigned short) d->imm;
+    LaneWords address;
+
+    r[IR] = SELECT(mask, (LaneWords) {0} + d->word, r[IR]);
+    r[PC] = SELECT(mask, r[PC] + 0x02, r[PC]);
+
+    switch (d->op) {
+        case OP_HALT:
+            group->flags |= mask & 0x1;
+            group->live &= ~mask;
+            group->firstLive = -1;
+            for (int lane = LANE_COUNT - 1; lane >= 0; lane--) {
+                if (group->live[lane]) group->firstLive = lane;
+            }
+            break;
+        case OP_NOP:
+            break;
+        case OP_RET:
+            r[SP] = SELECT(mask, r[BP], r[SP]);
+            lockstepLoad(group, &r[SP], &mask, leader, &r[BP]);
+            r[SP] = SELECT(mask, r[SP] - 0x02, r[SP]);
+            lockstepLoad(group, &r[SP], &mask, leader, &r[PC]);
+            break;
+        case OP_LODI:
+            r[d->regA] = SELECT(mask, imm, r[d->regA]);
+            break;
+        case OP_LODA:
+            lockstepLoad(group, &imm, &mask, leader, &r[d->regA]);
+            break;
+        case OP_LODR:
+            address = (LaneWords) {0} + d->regB; // same as lodr()
+            lockstepLoad(group, &address, &mask, leader, &r[d->regA]);
+            break;
+        case OP_LODRD:
+            address = r[d->regB] + imm;
+            lockstepLoad(group, &address, &mask, leader, &r[d->regA]);
+            break;
+        case OP_STOA:
+            lockstepStore(group, &imm, &r[d->regA], &mask, leader);
+            break;
+        case OP_STOR:
+            lockstepStore(group, &r[d->regB], &r[d->regA], &mask, leader);
+            break;
+        case OP_STORD:
+            address = r[d->regB] + imm;
+            lockstepStore(group, &address, &r[d->regA], &mask, leader);
+            break;
+        case OP_NEG:
+            r[AC] = SELECT(mask, -r[d->regA], r[AC]);
+            break;
+        case OP_ADDR:
+            r[AC] = SELECT(mask, r[d->regA] + r[d->regB], r[AC]);
+            break;
+        case OP_ADDI:
+            r[AC] = SELECT(mask, r[d->regA] + imm, r[AC]);
+            break;
+        case OP_SUBR:
+            r[AC] = SELECT(mask, r[d->regA] - r[d->regB], r[AC]);
+            break;
+        case OP_SUBI:
+            r[AC] = SELECT(mask, r[d->regA] - imm, r[AC]);
+            break;
+        case OP_MOV:
+            r[d->regA] = SELECT(mask, r[d->regB], r[d->regA]);
+            break;
+        case OP_JMP:
+            r[PC] = SELECT(mask, imm, r[PC]);
+            break;
+        case OP_JMPZ: {
+            LaneWords taken = mask & (LaneWords) (r[AC] == 0x0000);
+            r[PC] = SELECT(taken, imm, r[PC]);
+            break;
+        }
+        case OP_JMPN: {
+            LaneWords taken = mask & (LaneWords) ((r[AC] & 0x8000) != 0);
+            r[PC] = SELECT(taken, imm, r[PC]);
+            break;
+        }
+        case OP_CALL:
+            lockstepStore(group, &r[SP], &r[PC], &mask, leader);
+            r[SP] = SELECT(mask, r[SP] + 0x02, r[SP]);
+            r[PC] = SELECT(mask, imm, r[PC]);
+            lockstepStore(group, &r[SP], &r[BP], &mask, leader);
+            r[BP] = SELECT(mask, r[SP], r[BP]);
+            r[SP] = SELECT(mask, r[SP] + 0x02, r[SP]);
+            break;
+        default:
+            // Operation not recognized; set error flag
+            group->flags |= mask & 0x2;
+            break;
+    }
+}
+
+void lockstepRun(LockstepGroup *group) {
+    while (group->firstLive >= 0) {
+        int leader = group->firstLive;
+        unsigned short pc = group->R[PC][leader];
+
+        LaneWords apart = group->live & (LaneWords) (group->R[PC] != pc);
+        if (anyLane(&apart)) {
+            // Lead with the lowest PC, so lanes that branched ahead wait for the others to
+            // catch up and the group reconverges where the branches meet again.
+            for (int lane = leader + 1; lane < LANE_COUNT; lane++) {
+                if (group->live[lane] && group->R[PC][lane] < pc) {
+                    leader = lane;
+                    pc = group->R[PC][lane];
+                }
+            }
+        }
+        LaneWords mask = group->live & (LaneWords) (group->R[PC] == pc);
+
+        // A cached instruction is the same in every live lane (writes over it invalidate
+        // it). Otherwise, run the leader's instruction only in the lanes that hold the same
+        // word, and cache it if that is all of them.
+        DecodedInstruction *d = &group->decoded[pc];
+        if (!d->valid) {
+            unsigned short word = lockstepGetWord(group, leader, pc);
+            LaneWords words = {0}, here = (LaneWords) {0} + pc;
+            lockstepLoad(group, &here, &group->live, group->firstLive, &words);
+            LaneWords different = group->live & (LaneWords) (words != word);
+            decodeInstruction(word, d);
+            d->tag = pc;
+            d->valid = !anyLane(&different);
+            mask &= ~different;
+        }
+        lockstepExecute(group, d, &mask, leader);
+    }
+}
+
+void lockstepExtract(LockstepGroup *group, int lane, SsamVm *vm) {
+    for (int i = 0; i < REG_COUNT; i++) vm->R[i] = group->R[i][lane];
+    vm->flags = group->flags[lane];
+    for (int address = 0; address < MEMORY_SIZE; address++) vm->memory[address] = group->memory[address][lane];
+    resetDecoded(vm);
+}
+
+/**
+ * Applies the writes (address=value) on an input line to one lane.
+ * @param group the group
+ * @param lane the lane
+ * @param line the input line
+ * @param lineNumber the line's number, for error messages
+ * @return 0 on success, 1 if the line is malformed
+ */
+int applyLockstepInput(LockstepGroup *group, int lane, const char *line, int lineNumber) {
+    char copy[LINE_SIZE];
+    char *save;
+    strcpy(copy, line);
+    for (char *token = strtok_r(copy, " \t\r\n", &save); token; token = strtok_r(NULL, " \t\r\n", &save)) {
+        unsigned short address, value;
+        char end;
+        if (sscanf(token, "%hx=%hx", &address, &value) == 2) {
+            lockstepSetWord(group, lane, address, value);
+        } else if (sscanf(token, "%hx%c", &address, &end) != 2 || end != '?') {
+            fprintf(stderr, "Error: couldn't read \"%s\" on line %d of the input.\n", token, lineNumber);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Prints the final state of one lane: its flags, registers, and the words asked for
+ * (address?) on its input line.
+ * @param group the group
+ * @param lane the lane
+ * @param line the input line
+ * @param lineNumber the line's number
+ */
+void printLockstepResult(LockstepGroup *group, int lane, const char *line, int lineNumber) {
+    const char *registerNames[] = {"R0", "R1", "R2", "R3", "AC", "SP", "BP", "PC", "IR"};
+    char copy[LINE_SIZE];
+    char *save;
+
+    printf("%d:", lineNumber);
+    if (group->flags[lane] & 0x2) printf(" [ERROR]");
+    if (group->flags[lane] & 0x1) printf(" [HALT]");
+    for (int i = 0; i < REG_COUNT; i++) printf(" %s=0x%04hx", registerNames[i], group->R[i][lane]);
+
+    strcpy(copy, line);
+    for (char *token = strtok_r(copy, " \t\r\n", &save); token; token = strtok_r(NULL, " \t\r\n", &save)) {
+        unsigned short address;
+        char end;
+        if (sscanf(token, "%hx%c", &address, &end) == 2 && end == '?') {
+            printf(" 0x%04hx=0x%04hx", address, lockstepGetWord(group, lane, address));
+        }
+    }
+    printf("\n");
+}
+
+int runLockstep(const char *binaryPath, short sp, short pc, const char *inputPath) {
+    FILE *binary = fopen(binaryPath, "rb");
+    if (!binary) {
+        fprintf(stderr, "Error: specified binary file \"%s\" could not be loaded.\n", binaryPath);
+        return 1;
+    }
+    FILE *input = fopen(inputPath, "r");
+    if (!input) {
+        fprintf(stderr, "Error: input file \"%s\" could not be opened.\n", inputPath);
+        fclose(binary);
+        return 1;
+    }
+
+    // Load the program once; every lane starts from a copy of this image
+    SsamVm *image = createVm();
+    LockstepGroup *group = createLockstepGroup();
+    if (!image || !group) {
+        fprintf(stderr, "Error: could not allocate the VM.\n");
+        destroyVm(image);
+        destroyLockstepGroup(group);
+        fclose(binary);
+        fclose(input);
+        return 1;
+    }
+    int programSize = loadProgram(image, binary);
+    fclose(binary);
+    if (programSize < 0) {
+        fprintf(stderr, "Error: specified binary file \"%s\" could not be loaded.\n", binaryPath);
+        destroyVm(image);
+        destroyLockstepGroup(group);
+        fclose(input);
+        return 1;
+    }
+
+    char lines[LANE_COUNT][LINE_SIZE];
+    int lineNumbers[LANE_COUNT];
+    int laneCount = 0, lineNumber = 0, failed = 0, more = 1;
+
+    while (more && !failed) {
+        // Gather the next group of inputs
+        laneCount = 0;
+        while (laneCount < LANE_COUNT && (more = fgets(lines[laneCount], LINE_SIZE, input) != NULL)) {
+            lineNumber++;
+            char first[2];
+            if (sscanf(lines[laneCount], "%1s", first) != 1 || first[0] == '#') continue;
+            lineNumbers[laneCount++] = lineNumber;
+        }
+        if (laneCount == 0) break;
+
+        lockstepInit(group, getMemory(image), laneCount, sp, pc);
+        for (int lane = 0; lane < laneCount && !failed; lane++) {
+            failed = applyLockstepInput(group, lane, lines[lane], lineNumbers[lane]);
+        }
+        if (failed) break;
+
+        lockstepRun(group);
+        for (int lane = 0; lane < laneCount; lane++) {
+            printLockstepResult(group, lane, lines[lane], lineNumbers[lane]);
+        }
+    }
+
+    fclose(input);
+    destroyVm(image);
+    destroyLockstepGroup(group);
+    return failed;
+}
@@ -0,0 +1,109 @@
+// Runs one program on many VMs at once, one VM per SIMD lane.
+// Created by Jackson Eshbaugh on 16.10.2026.
+
+#ifndef LOCKSTEP_H
+#define LOCKSTEP_H
+
+#include "vm.h"
+
+#define LANE_COUNT 16 // 16 x 16-bit lanes fill one AVX2 register (or two SSE registers)
+
+typedef unsigned short LaneWords __attribute__((vector_size(LANE_COUNT * sizeof(unsigned short))));
+typedef unsigned char LaneBytes __attribute__((vector_size(LANE_COUNT)));
+
+/**
+ * LANE_COUNT VMs stored structure-of-arrays style: each register is one vector holding
+ * that register for every lane, and each byte of memory is a row holding that byte for
+ * every lane. Every step runs one instruction across all the lanes that are at the same
+ * PC; the rest are masked off until the group reaches them.
+ * The vector types are GCC/Clang vector extensions, which are compiled to SSE or AVX2.
+ */
+typedef struct LockstepGroup {
+    LaneWords R[REG_COUNT];
+    LaneWords flags; // per lane: 0th bit is the haltReached flag; 1st is the error flag
+    LaneWords live; // 0xffff for each lane that is in use and hasn't halted
+    int firstLive; // the lowest live lane, or -1 once every lane has halted
+
+    // Decoded instructions, by address; the word is checked on every use since lanes
+    // may hold different code.
+    DecodedInstruction decoded[MEMORY_SIZE];
+    LaneBytes memory[MEMORY_SIZE];
+} LockstepGroup;
+
+/**
+ * Creates a group with no lanes in use.
+ * @return the new group, or NULL if it could not be allocated
+ */
+LockstepGroup *createLockstepGroup();
+
+/**
+ * Destroys a group.
+ * @param group the group to destroy
+ */
+void destroyLockstepGroup(LockstepGroup *group);
+
+/**
+ * Sets up the first laneCount lanes like controllerInit(), each with its own copy of image
+ * in memory. The remaining lanes are left out of every step.
+ *
+ * @param group the group
+ * @param image the MEMORY_SIZE bytes of memory every lane starts with
+ * @param laneCount how many lanes to use, at most LANE_COUNT
+ * @param sp the initial stack pointer
+ * @param pc the initial program counter
+ */
+void lockstepInit(LockstepGroup *group, const unsigned char *image, int laneCount, short sp, short pc);
+
+/**
+ * Writes a word into one lane's memory.
+ * @param group the group
+ * @param lane the lane to write to
+ * @param address the address to write to
+ * @param value the word to write
+ */
+void lockstepSetWord(LockstepGroup *group, int lane, unsigned short address, unsigned short value);
+
+/**
+ * Reads a word from one lane's memory.
+ * @param group the group
+ * @param lane the lane to read from
+ * @param address the address to read from
+ * @return the word at address
+ */
+unsigned short lockstepGetWord(LockstepGroup *group, int lane, unsigned short address);
+
+/**
+ * Runs every lane until it halts, like H does for a single VM. Lanes that branch apart
+ * are run separately, lowest PC first, until they meet again.
+ * @param group the group
+ */
+void lockstepRun(LockstepGroup *group);
+
+/**
+ * Copies one lane's registers, flags and memory into a VM, so that it can be inspected
+ * with getRegister(), getWord(), logState() and friends.
+ *
+ * @param group the group
+ * @param lane the lane to copy
+ * @param vm the VM to copy into
+ */
+void lockstepExtract(LockstepGroup *group, int lane, SsamVm *vm);
+
+/**
+ * Runs a program once for each line of an input file, LANE_COUNT runs at a time. Each line
+ * lists words to write before the run and words to report after it:
+ *
+ *     0x0200=0x0005 0x0202=0x0007 0x0204?
+ *
+ * writes 5 and 7 to 0x0200 and 0x0202, then, once the run halts, prints the word at
+ * 0x0204 after the registers. Blank lines and lines starting with '#' are skipped.
+ *
+ * @param binaryPath the program to run
+ * @param sp the initial stack pointer
+ * @param pc the initial program counter
+ * @param inputPath the input file
+ * @return 0 on success, 1 if a file couldn't be read
+ */
+int runLockstep(const char *binaryPath, short sp, short pc, const char *inputPath);
+
+#endif //LOCKSTEP_H
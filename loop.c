@@ -0,0 +1,139 @@
+// Finds runs that can never halt, by noticing the VM is back in a state it was in before.
+// Created by Jackson Eshbaugh on 16.10.2026.
+
+#include "loop.h"
+#include "controller.h"
+#include "memory.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Hashes one page of memory. The page number is mixed in, so the same bytes hash
+ * differently on different pages and the page hashes can simply be added up.
+ * @param memory the VM's memory
+ * @param page the page
+ * @return the hash
+ */
+unsigned long long hashPage(const unsigned char *memory, int page) {
+    const unsigned char *bytes = memory + (page << PAGE_SHIFT);
+    unsigned long long hash = 0x9E3779B97F4A7C15ULL * (page + 1);
+    for (int i = 0; i < PAGE_BYTES; i += 8) {
+        unsigned long long word;
+        memcpy(&word, bytes + i, sizeof(word));
+        hash = (hash ^ word) * 0xFF51AFD7ED558CCDULL;
+        hash ^= hash >> 32;
+    }
+    return hash;
+}
+
+/**
+ * Hashes the VM's whole state, hashing again the pages written since the last time.
+ * @param vm the VM
+ * @return the hash
+ */
+unsigned long long hashState(SsamVm *vm) {
+    LoopDetector *loops = vm->loops;
+    const unsigned char *memory = getMemory(vm);
+    for (int i = 0; i < loops->dirtyCount; i++) {
+        unsigned short page = loops->dirtyPages[i];
+        unsigned long long hash = hashPage(memory, page);
+        loops->memoryHash += hash - loops->pageHashes[page];
+        loops->pageHashes[page] = hash;
+        vm->pageFlags[page] |= PAGE_HASHED;
+    }
+    loops->dirtyCount = 0;
+
+    unsigned long long hash = loops->memoryHash ^ (unsigned char) vm->flags;
+    for (int r = 0; r < REG_COUNT; r++) {
+        hash = (hash ^ vm->R[r]) * 0xC4CEB9FE1A85EC53ULL;
+        hash ^= hash >> 29;
+    }
+    return hash;
+}
+
+/**
+ * Makes the VM's current state the one later states are compared against.
+ * @param vm the VM
+ * @param hash the state's hash
+ */
+void saveLoopState(SsamVm *vm, unsigned long long hash) {
+    LoopDetector *loops = vm->loops;
+    loops->savedHash = hash;
+    memcpy(loops->savedR, vm->R, sizeof(vm->R));
+    loops->savedFlags = vm->flags;
+    memcpy(loops->savedMemory, getMemory(vm), MEMORY_SIZE);
+}
+
+/**
+ * Runs the VM round the loop it is in, noting the lowest and highest addresses it runs.
+ * @param vm the VM
+ * @param maxSteps the most instructions to run
+ */
+void scanLoop(SsamVm *vm, unsigned long long maxSteps) {
+    LoopDetector *loops = vm->loops;
+    unsigned long long steps = loops->period < maxSteps ? loops->period : maxSteps;
+    loops->scanned = steps;
+    loops->low = loops->high = vm->R[PC];
+    for (unsigned long long i = 0; i < steps; i++) {
+        unsigned short pc = vm->R[PC];
+        if (pc < loops->low) loops->low = pc;
+        if (pc > loops->high) loops->high = pc;
+        runUntil(vm, 1);
+    }
+}
+
+int enableLoopDetection(SsamVm *vm) {
+    if (vm->loops) return 1;
+    vm->loops = calloc(1, sizeof(LoopDetector));
+    return vm->loops != NULL;
+}
+
+void startLoopCheck(SsamVm *vm) {
+    LoopDetector *loops = vm->loops;
+    // Pages still flagged haven't changed since they were hashed; the rest were written,
+    // or have never been hashed
+    loops->dirtyCount = 0;
+    for (int page = 0; page < PAGE_COUNT; page++) {
+        if (!(vm->pageFlags[page] & PAGE_HASHED)) loops->dirtyPages[loops->dirtyCount++] = page;
+    }
+    loops->nextCheck = vm->cycles + LOOP_CHECK_STEPS;
+
+    saveLoopState(vm, hashState(vm));
+    loops->power = 1;
+    loops->length = 0;
+}
+
+unsigned long long loopStepsLeft(SsamVm *vm) {
+    return vm->loops->nextCheck - vm->cycles;
+}
+
+int loopCheck(SsamVm *vm, unsigned long long maxScan) {
+    LoopDetector *loops = vm->loops;
+    loops->nextCheck += LOOP_CHECK_STEPS;
+
+    unsigned long long hash = hashState(vm);
+    loops->length++;
+    if (hash == loops->savedHash && vm->flags == loops->savedFlags &&
+        memcmp(vm->R, loops->savedR, sizeof(vm->R)) == 0 &&
+        memcmp(getMemory(vm), loops->savedMemory, MEMORY_SIZE) == 0) {
+        loops->period = loops->length * LOOP_CHECK_STEPS;
+        scanLoop(vm, maxScan);
+        return 1;
+    }
+
+    // Brent: move the saved state up to this one each time the distance between them
+    // reaches a power of two
+    if (loops->length == loops->power) {
+        saveLoopState(vm, hash);
+        loops->power *= 2;
+        loops->length = 0;
+    }
+    return 0;
+}
+
+void destroyLoopDetection(SsamVm *vm) {
+    if (!vm->loops) return;
+    for (int page = 0; page < PAGE_COUNT; page++) vm->pageFlags[page] &= ~PAGE_HASHED;
+    free(vm->loops);
+    vm->loops = NULL;
+}
@@ -0,0 +1,96 @@
+// Finds runs that can never halt, by noticing the VM is back in a state it was in before.
+// Created by Jackson Eshbaugh on 16.10.2026.
+//
+// With no devices mapped, the VM's next state follows from its registers, flags and
+// memory alone, so once a state comes round again the run repeats itself forever. Every
+// LOOP_CHECK_STEPS instructions, runLimited() hashes the state and takes a step of Brent's
+// cycle-finding algorithm: the hash is compared with that of one saved state, and the
+// saved state is replaced by the current one whenever the number of checks since it was
+// saved reaches the next power of two. A loop is found within a few times as many checks
+// as it takes to go round plus it took to reach, whatever its length.
+//
+// Only the pages written since the last check are hashed again: writes to a page clear
+// its PAGE_HASHED flag and add it to the detector's list. Anything that changes memory
+// other than through setWord() and setByte() must clear the flag of the pages it changes.
+// A matching hash is confirmed by comparing the whole state with a copy of the saved one,
+// so a collision can't end a run. Once a loop is confirmed, it is run round once more, one
+// instruction at a time, to find the range of addresses it runs, as far as what is left of
+// the run's budget (and a chunk of it, with a timeout) allows.
+//
+// What it costs: each run started by runLimited() hashes the pages without PAGE_HASHED
+// (all 256, or 64 KiB, the first time; since then only those written) and copies the
+// state, 64 KiB, as the first to compare against. While it runs, the first store to a page
+// after each check takes the slow path through pageWritten() to clear its flag, and each
+// check hashes the pages written since the last. Brent's algorithm copies the state again
+// each time the saved state moves, which happens a logarithmic number of times.
+
+#ifndef LOOP_H
+#define LOOP_H
+
+#include "vm.h"
+
+#define LOOP_CHECK_STEPS 0x10000 // instructions run between checks
+#define LOOP_SCAN_MAX 0x400000 // the most instructions run to find a loop's addresses
+
+/**
+ * A VM's loop detector: the hash of each page, Brent's saved state, and what was found.
+ */
+typedef struct LoopDetector {
+    unsigned long long pageHashes[PAGE_COUNT];
+    unsigned long long memoryHash; // the sum of pageHashes
+    unsigned short dirtyPages[PAGE_COUNT]; // pages written since they were last hashed
+    int dirtyCount;
+    unsigned long long nextCheck; // the value of vm->cycles to check at
+
+    // The saved state, and the checks since it was saved
+    unsigned long long savedHash;
+    unsigned long long power;
+    unsigned long long length;
+    unsigned short savedR[REG_COUNT];
+    char savedFlags;
+    unsigned char savedMemory[MEMORY_SIZE];
+
+    // The loop found
+    unsigned long long period; // instructions in one time round (a multiple of its length)
+    unsigned long long scanned; // instructions run to find low and high, at most period
+    unsigned short low, high; // the lowest and highest addresses it runs
+} LoopDetector;
+
+/**
+ * Turns on loop detection for a VM's limited runs (see runLimited() in controller.h).
+ * @param vm the VM
+ * @return 1 on success, 0 if the detector couldn't be allocated
+ */
+int enableLoopDetection(SsamVm *vm);
+
+/**
+ * Hashes the pages of memory that have changed since they were last hashed, and saves the
+ * VM's state as the first one to compare against. Called at the start of each limited run.
+ * @param vm the VM
+ */
+void startLoopCheck(SsamVm *vm);
+
+/**
+ * The number of instructions to run before the next check.
+ * @param vm the VM
+ * @return the instructions left, 0 if a check is due
+ */
+unsigned long long loopStepsLeft(SsamVm *vm);
+
+/**
+ * Checks whether the VM is in a state it was in before. If it is, runs it round the loop
+ * once more, or maxScan instructions if the loop is longer, to fill in the range of
+ * addresses it runs. Only called when loopStepsLeft() is 0.
+ * @param vm the VM
+ * @param maxScan the most instructions to run to find the range
+ * @return 1 if the VM is in a loop it can never leave, 0 if not
+ */
+int loopCheck(SsamVm *vm, unsigned long long maxScan);
+
+/**
+ * Turns off loop detection and frees the detector, if the VM has one.
+ * @param vm the VM
+ */
+void destroyLoopDetection(SsamVm *vm);
+
+#endif //LOOP_H
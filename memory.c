@@ -2,44 +2,197 @@
 // Also contains functionality to load a file into memory.
 // Created by Jackson Eshbaugh on 28.10.2024.
 
+#define _GNU_SOURCE // memfd_create() and file seals
 #include "memory.h"
+#include "controller.h"
+#include "image.h"
+#include "device.h"
+#include "loop.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
-#define MEMORY_SIZE 0xFFFF
+/**
+ * A program image held once for the whole process, in a sealed memfd that VMs loading the
+ * same image map copy-on-write over the start of their memory.
+ */
+typedef struct SharedImage {
+    struct SharedImage *next;
+    int fd;
+    size_t length; // bytes mapped: the image, rounded up to whole host pages
+    const unsigned char *data; // a read-only mapping of fd, to compare images against
+} SharedImage;
 
-unsigned char memory[MEMORY_SIZE];
+SharedImage *sharedImages = NULL;
+pthread_mutex_t sharedImagesLock = PTHREAD_MUTEX_INITIALIZER;
 
-unsigned char getByte(unsigned short address) {
-    return memory[address];
+unsigned char getByte(SsamVm *vm, unsigned short address) {
+    return vm->memory[address];
 }
 
-unsigned short getWord(unsigned short address) {
-    return memory[address] << 8 | memory[address + 1];
+unsigned short getWord(SsamVm *vm, unsigned short address) {
+    if (vm->pageFlags[address >> PAGE_SHIFT] & PAGE_DEVICE) return deviceRead(vm, address);
+    return vm->memory[address] << 8 | vm->memory[(unsigned short) (address + 1)];
 }
 
-void setByte(unsigned short address, unsigned char value) {
-    memory[address] = value;
+/**
+ * Records that a page was written, adding it to the dirty list if it was clean.
+ * @param vm the VM
+ * @param page the page that was written
+ */
+void markDirty(SsamVm *vm, unsigned short page) {
+    if (vm->pageFlags[page] & PAGE_CLEAN) {
+        vm->pageFlags[page] &= ~PAGE_CLEAN;
+        vm->dirtyPages[vm->dirtyCount++] = page;
+    }
+}
+
+/**
+ * Records that a page was written, adding it to the loop detector's list if it was hashed.
+ * @param vm the VM
+ * @param page the page that was written
+ */
+void markUnhashed(SsamVm *vm, unsigned short page) {
+    if (vm->pageFlags[page] & PAGE_HASHED) {
+        vm->pageFlags[page] &= ~PAGE_HASHED;
+        vm->loops->dirtyPages[vm->loops->dirtyCount++] = page;
+    }
+}
+
+/**
+ * Handles a write to the memory at address (address + 1 included, for a word) when one of
+ * the pages written has flags set.
+ * @param vm the VM
+ * @param address the address written to
+ * @param size the number of bytes written (1 or 2)
+ */
+void pageWritten(SsamVm *vm, unsigned short address, int size) {
+    unsigned short first = address >> PAGE_SHIFT;
+    unsigned short last = (unsigned short) (address + size - 1) >> PAGE_SHIFT;
+    int code = (vm->pageFlags[first] | vm->pageFlags[last]) & PAGE_CODE;
+
+    markDirty(vm, first);
+    markDirty(vm, last);
+    markUnhashed(vm, first);
+    markUnhashed(vm, last);
+    if (code) invalidateDecoded(vm, address);
+    if (vm->pageFlags[first] & PAGE_DEVICE) {
+        deviceWrite(vm, address, vm->memory[address] << 8 | vm->memory[(unsigned short) (address + 1)]);
+    }
+}
+
+void setByte(SsamVm *vm, unsigned short address, unsigned char value) {
+    vm->memory[address] = value;
+    if (vm->pageFlags[address >> PAGE_SHIFT]) pageWritten(vm, address, 1);
 }
 
-void setWord(unsigned short address, unsigned short value) {
+void setWord(SsamVm *vm, unsigned short address, unsigned short value) {
     // Break short into two chars
     unsigned char top = (value >> 8) & 0xFF;
     unsigned char bottom = value & 0xFF;
-    memory[address] = top;
-    memory[address + 1] = bottom;
+    vm->memory[address] = top;
+    vm->memory[(unsigned short) (address + 1)] = bottom;
+    if (vm->pageFlags[address >> PAGE_SHIFT] | vm->pageFlags[(unsigned short) (address + 1) >> PAGE_SHIFT]) {
+        pageWritten(vm, address, 2);
+    }
 }
 
-void loadProgram(FILE *fileHandler) {
-    int inputDataSize = 0;
+unsigned char *getMemory(SsamVm *vm) {
+    return vm->memory;
+}
+
+void markCode(SsamVm *vm, unsigned short address) {
+    vm->pageFlags[address >> PAGE_SHIFT] |= PAGE_CODE;
+    vm->pageFlags[(unsigned short) (address + 1) >> PAGE_SHIFT] |= PAGE_CODE;
+}
 
-    while(!feof(fileHandler)) {
-        // Continue progressing through the input data, reading one byte at a time
-        // until reaching the end of the file.
-        fread((memory + inputDataSize), 1, 1, fileHandler);
-        inputDataSize++;
+void clearMemory(SsamVm *vm) {
+    // Fresh anonymous memory mapped over the old drops the written pages
+    void *memory = mmap(vm->memory, MEMORY_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED,
+                        -1, 0);
+    if (memory == MAP_FAILED) memset(vm->memory, 0, MEMORY_SIZE);
+}
+
+/**
+ * Checks whether a range of memory is all zero.
+ * @param bytes the range
+ * @param length its length in bytes
+ * @return 1 if every byte is zero, 0 if not
+ */
+int isZeroed(const unsigned char *bytes, size_t length) {
+    return length == 0 || (bytes[0] == 0 && memcmp(bytes, bytes + 1, length - 1) == 0);
+}
+
+/**
+ * Finds the shared copy of an image, making one if this is the first VM to load it.
+ * @param image the loaded image, the first length bytes of a zeroed memory
+ * @param length the bytes to share, a whole number of host pages
+ * @return the shared copy, or NULL if one couldn't be made
+ */
+SharedImage *findSharedImage(const unsigned char *image, size_t length) {
+    pthread_mutex_lock(&sharedImagesLock);
+    SharedImage *shared = sharedImages;
+    while (shared && (shared->length != length || memcmp(shared->data, image, length) != 0)) {
+        shared = shared->next;
+    }
+    if (shared) {
+        pthread_mutex_unlock(&sharedImagesLock);
+        return shared;
     }
-    fclose(fileHandler);
 
-    if(ferror(fileHandler)) {
-        fprintf(stderr, "Error reading file at size %d.\n", inputDataSize);
+#ifdef MFD_ALLOW_SEALING
+    // Only the pages with something on them are written; the rest stay holes
+    long pageSize = sysconf(_SC_PAGESIZE);
+    int fd = memfd_create("ssam-image", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    int written = fd >= 0 && ftruncate(fd, (off_t) length) == 0;
+    for (size_t page = 0; written && page < length; page += pageSize) {
+        if (isZeroed(image + page, pageSize)) continue;
+        written = pwrite(fd, image + page, pageSize, (off_t) page) == pageSize;
+    }
+    // Sealed, nothing can change the copy once VMs map it, not even this process
+    if (written && fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) == 0) {
+        void *data = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        shared = data != MAP_FAILED ? malloc(sizeof(SharedImage)) : NULL;
+        if (shared) {
+            *shared = (SharedImage) {.next = sharedImages, .fd = fd, .length = length, .data = data};
+            sharedImages = shared;
+        } else if (data != MAP_FAILED) {
+            munmap(data, length);
+        }
     }
-}
\ No newline at end of file
+    if (!shared && fd >= 0) close(fd);
+#endif
+    pthread_mutex_unlock(&sharedImagesLock);
+    return shared;
+}
+
+int loadProgram(SsamVm *vm, FILE *fileHandler) {
+    // A segmented image leaves the memory around its segments alone, so only a zeroed
+    // memory can take the shared copy
+    if (!isZeroed(vm->memory, MEMORY_SIZE)) return loadImage(fileHandler, vm->memory);
+
+    // The image is read into a scratch memory first; the file itself is never mapped, so
+    // changing or truncating it can't reach the VM
+    unsigned char *image = calloc(1, MEMORY_SIZE);
+    if (!image) return loadImage(fileHandler, vm->memory);
+    int end = loadImage(fileHandler, image);
+    if (end <= 0) {
+        free(image);
+        return end;
+    }
+
+    long pageSize = sysconf(_SC_PAGESIZE);
+    size_t length = pageSize > 0 ? (end + pageSize - 1) / pageSize * pageSize : 0;
+    SharedImage *shared = length > 0 && length <= MEMORY_SIZE ? findSharedImage(image, length) : NULL;
+    if (!shared || mmap(vm->memory, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, shared->fd, 0)
+                   == MAP_FAILED) {
+        // A failed fixed mapping may have unmapped what was there, so map zeroes back first
+        clearMemory(vm);
+        memcpy(vm->memory, image, end);
+    }
+    free(image);
+    return end;
+}
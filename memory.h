@@ -5,42 +5,75 @@
 #ifndef MEMORY_H
 #define MEMORY_H
 #include <stdio.h>
+#include "vm.h"
 
 /**
  * Memory[address] <== byte
  * Sets the byte at the given address to the value given by byte.
+ * @param vm the VM
  * @param address the address to update
  * @param byte the value to write at address
  */
-void setByte(unsigned short address, unsigned char byte);
+void setByte(SsamVm *vm, unsigned short address, unsigned char byte);
 
 /**
  * Memory[address] <== word
  * Sets the word at the given address to the value given by word.
+ * @param vm the VM
  * @param address the address to update
  * @param word the value to write at address
  */
-void setWord(unsigned short address, unsigned short word);
+void setWord(SsamVm *vm, unsigned short address, unsigned short word);
 
 /**
  * (ret) <== Memory[address]
  * Fetches the byte at the given address.
+ * @param vm the VM
  * @param address the address to read memory at
  * @return the byte located at address in memory
  */
-unsigned char getByte(unsigned short address);
+unsigned char getByte(SsamVm *vm, unsigned short address);
 
 /**
  * Fetches the word at the given address.
+ * @param vm the VM
  * @param address the address to read memory at
  * @return the word located at address in memory
  */
-unsigned short getWord(unsigned short address);
+unsigned short getWord(SsamVm *vm, unsigned short address);
 
 /**
- * Loads the program into memory from the provided file.
+ * Gets the memory array itself, for code that accesses it directly (the JIT).
+ * The array covers the full 64 KiB address space.
+ * @param vm the VM
+ * @return a pointer to the first byte of memory
+ */
+unsigned char *getMemory(SsamVm *vm);
+
+/**
+ * Marks the word at address as holding decoded code. Writes to a page with code on it
+ * are reported to the controller through invalidateDecoded().
+ * @param vm the VM
+ * @param address the address of the decoded instruction
+ */
+void markCode(SsamVm *vm, unsigned short address);
+
+/**
+ * Zeroes the VM's memory, handing every page it wrote back to the host.
+ * @param vm the VM
+ */
+void clearMemory(SsamVm *vm);
+
+/**
+ * Loads the program into memory from the provided file, which may be a flat or a
+ * segmented image (see image.h). The file is read once and never mapped. Into a zeroed
+ * memory, the pages the image covers are then mapped copy-on-write from a sealed copy of
+ * it that every VM in the process loading the same image shares, and kept for as long as
+ * the process runs; otherwise the image is copied in.
+ * @param vm the VM
  * @param fileHandler the file to load bytes into memory from.
+ * @return one past the highest address loaded, or -1 if the file couldn't be loaded
  */
-void loadProgram(FILE *fileHandler);
+int loadProgram(SsamVm *vm, FILE *fileHandler);
 
 #endif //MEMORY_H
@@ -0,0 +1,110 @@
+// Counts where guest time goes: per-address hotspots, the instruction mix, and branches.
+// Created by Jackson Eshbaugh on 16.10.2026.
+
+#include "profile.h"
+#include "controller.h"
+#include <stdlib.h>
+
+#define HOTSPOT_COUNT 20
+
+const char *classNames[] = {"flow", "transfer", "manipulate", "jump"};
+
+const char *operationNames[OP_COUNT] = {
+    [OP_HALT] = "halt", [OP_NOP] = "nop", [OP_RET] = "ret", [OP_LODI] = "lodi",
+    [OP_LODA] = "loda", [OP_LODR] = "lodr", [OP_LODRD] = "lodrd", [OP_STOA] = "stoa",
+    [OP_STOR] = "stor", [OP_STORD] = "stord", [OP_NEG] = "neg", [OP_ADDR] = "addr",
+    [OP_ADDI] = "addi", [OP_SUBR] = "subr", [OP_SUBI] = "subi", [OP_MOV] = "mov",
+    [OP_JMP] = "jmp", [OP_JMPZ] = "jmpz", [OP_JMPN] = "jmpn", [OP_CALL] = "call",
+    [OP_ERROR] = "(error)", [OP_SUBI_JMPN] = "subi+jmpn", [OP_ADDI_MOV] = "addi+mov",
+    [OP_LODI_STOA] = "lodi+stoa", [OP_BREAK] = "(break)"
+};
+
+int enableProfile(SsamVm *vm) {
+#ifdef SSAM_PROFILE
+    if (!vm->profile) vm->profile = calloc(1, sizeof(Profile));
+    return vm->profile != NULL;
+#else
+    (void) vm;
+    return 0;
+#endif
+}
+
+void profileInstruction(Profile *profile, const DecodedInstruction *d, unsigned short ac) {
+    profile->total++;
+    profile->addressCounts[d->tag]++;
+    profile->classCounts[d->word >> 14]++;
+    profile->operationCounts[d->op]++;
+
+    if (d->op == OP_JMPZ) {
+        if (ac == 0x0000) profile->taken[0]++;
+        else profile->notTaken[0]++;
+    } else if (d->op == OP_JMPN) {
+        if ((short) ac < 0) profile->taken[1]++;
+        else profile->notTaken[1]++;
+    }
+}
+
+/**
+ * Works out a count as a percentage of all instructions run.
+ * @param profile the counts
+ * @param count the count
+ * @return count as a percentage of profile->total
+ */
+double percentOf(const Profile *profile, unsigned long long count) {
+    return profile->total ? 100.0 * (double) count / (double) profile->total : 0.0;
+}
+
+void printProfile(const Profile *profile, FILE *out) {
+    fprintf(out, "PROFILE: %llu instructions\n\n", profile->total);
+
+    fprintf(out, " CLASS                  COUNT        %%\n");
+    fprintf(out, "----------------------------------------\n");
+    for (int i = 0; i < 4; i++) {
+        fprintf(out, " %-12s %14llu  %6.2f%%\n", classNames[i], profile->classCounts[i],
+                percentOf(profile, profile->classCounts[i]));
+    }
+
+    // Operations, most-run first. There are few enough to select the max each time.
+    fprintf(out, "\n OPERATION              COUNT        %%\n");
+    fprintf(out, "----------------------------------------\n");
+    unsigned char listed[OP_COUNT] = {0};
+    for (int rank = 0; rank < OP_COUNT; rank++) {
+        int best = -1;
+        for (int op = 0; op < OP_COUNT; op++) {
+            if (listed[op] || !profile->operationCounts[op]) continue;
+            if (best < 0 || profile->operationCounts[op] > profile->operationCounts[best]) best = op;
+        }
+        if (best < 0) break;
+        listed[best] = 1;
+        fprintf(out, " %-12s %14llu  %6.2f%%\n", operationNames[best], profile->operationCounts[best],
+                percentOf(profile, profile->operationCounts[best]));
+    }
+
+    fprintf(out, "\n BRANCH          TAKEN      NOT TAKEN\n");
+    fprintf(out, "----------------------------------------\n");
+    fprintf(out, " jmpz   %14llu %14llu\n", profile->taken[0], profile->notTaken[0]);
+    fprintf(out, " jmpn   %14llu %14llu\n", profile->taken[1], profile->notTaken[1]);
+
+    // The hottest addresses, kept sorted by insertion as the counts are scanned
+    int hotspots[HOTSPOT_COUNT];
+    int hotspotCount = 0;
+    for (int address = 0; address < MEMORY_SIZE; address++) {
+        unsigned long long count = profile->addressCounts[address];
+        if (!count) continue;
+        if (hotspotCount == HOTSPOT_COUNT && count <= profile->addressCounts[hotspots[HOTSPOT_COUNT - 1]]) continue;
+
+        int slot = hotspotCount < HOTSPOT_COUNT ? hotspotCount++ : HOTSPOT_COUNT - 1;
+        while (slot > 0 && profile->addressCounts[hotspots[slot - 1]] < count) {
+            hotspots[slot] = hotspots[slot - 1];
+            slot--;
+        }
+        hotspots[slot] = address;
+    }
+
+    fprintf(out, "\n HOTSPOT                COUNT        %%\n");
+    fprintf(out, "----------------------------------------\n");
+    for (int i = 0; i < hotspotCount; i++) {
+        unsigned long long count = profile->addressCounts[hotspots[i]];
+        fprintf(out, " 0x%04x       %14llu  %6.2f%%\n", hotspots[i], count, percentOf(profile, count));
+    }
+}
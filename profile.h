@@ -0,0 +1,47 @@
+// Counts where guest time goes: per-address hotspots, the instruction mix, and branches.
+// Created by Jackson Eshbaugh on 16.10.2026.
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "vm.h"
+#include <stdio.h>
+
+/**
+ * Execution counts gathered while a VM runs with profiling on.
+ */
+typedef struct Profile {
+    unsigned long long total; // instructions run
+    unsigned long long addressCounts[MEMORY_SIZE]; // by the address each instruction ran from
+    unsigned long long classCounts[4]; // flow, transfer, manipulate, jump (the top two bits)
+    unsigned long long operationCounts[OP_COUNT]; // by Operation (never a superinstruction)
+    unsigned long long taken[2]; // jmpz, jmpn
+    unsigned long long notTaken[2];
+} Profile;
+
+/**
+ * Turns on profiling for a VM. Runs from then on are counted instruction by instruction
+ * (the JIT and superinstructions aren't used while profiling).
+ * @param vm the VM
+ * @return 1 on success, 0 if profiling was compiled out (see SSAM_PROFILE) or the counts
+ *         could not be allocated
+ */
+int enableProfile(SsamVm *vm);
+
+/**
+ * Counts one instruction. Called just before the instruction runs.
+ * @param profile the counts to update
+ * @param d the instruction; its tag is the address it runs from
+ * @param ac the value of AC before it runs, to tell if a jmpz/jmpn is taken
+ */
+void profileInstruction(Profile *profile, const DecodedInstruction *d, unsigned short ac);
+
+/**
+ * Writes a report of the counts: the instruction mix by class and by operation, how often
+ * each conditional jump was taken, and the hottest addresses, most-run first.
+ * @param profile the counts
+ * @param out the file to write the report to
+ */
+void printProfile(const Profile *profile, FILE *out);
+
+#endif //PROFILE_H
@@ -4,7 +4,21 @@
 #include "sim.h"
 #include "memory.h"
 #include "controller.h"
+#include "batch.h"
+#include "lockstep.h"
+#include "profile.h"
+#include "checkpoint.h"
+#include "undo.h"
+#include "watch.h"
+#include "device.h"
+#include "display.h"
+#include "format.h"
+#include "trace.h"
+#include "breakpoint.h"
+#include "loop.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define BUFFER_SIZE 1024
 
@@ -32,88 +46,149 @@ short strToHex(char *str) {
     return hex;
 }
 
-void printState(int originalBP, int originalPC) {
-    // Print error and halt statuses
-    if (errorOccurred() && haltReached()) printf("[ERROR]      [HALT]\n\n");
-    else if (errorOccurred()) printf("[ERROR]\n\n");
-    else if (haltReached()) printf("[HALT]\n\n");
-
-    // Headers for table
-    printf(" REGISTERS                MEMORY                PROGRAM MEMORY\n");
-    printf("----------------------------------------------------------------------\n");
-
-    short regCounter = 0;
-    int stackAddr = originalBP;
-    int progAddr = originalPC;
-
-    for (int i = 0; i < getRegister(BP); i++) {
-        // Print registers
-        if (regCounter < 9) {
-            const char* registerNames[] = {"R0", "R1", "R2", "R3", "AC", "SP", "BP", "PC", "IR"};
-            printf("%-3s: 0x%04hx          ", registerNames[regCounter], getRegister(regCounter));
-            regCounter++;
-        } else {
-            printf("                     "); // Empty space when there are no more registers to iterate through
-        }
+void printState(SsamVm *vm, int originalBP, int originalPC) {
+    logState(vm, stdout, originalBP, originalPC);
+}
+
+void logState(SsamVm *vm, FILE *logFile, int originalBP, int originalPC) {
+    StateLayout layout = {.format = FORMAT_TEXT, .originalBP = originalBP, .originalPC = originalPC};
+    writeState(vm, logFile, &layout);
+}
 
-        // Print stack memory
-        printf("0x%04hx: 0x%04hx", stackAddr, getWord(stackAddr));
-        if (stackAddr == getRegister(SP)) printf("  [SP]       ");
-        else if (stackAddr == getRegister(BP)) printf("  [BP]       ");
-        else printf("             ");
+/**
+ * Shows the state for the d and N commands, in the display's mode.
+ * @param vm the VM
+ * @param display the display
+ * @param layout the format and memory ranges for the full display
+ */
+void dumpState(SsamVm *vm, StateDisplay *display, const StateLayout *layout) {
+    if (display->mode == DISPLAY_FULL) {
+        writeState(vm, stdout, layout);
+        rememberState(display, vm);
+    } else {
+        showState(display, vm, stdout);
+    }
+}
 
-        // Print program memory
-        if (progAddr < originalPC + 40) {
-            printf("0x%04hx: 0x%04hx", progAddr, getWord(progAddr));
-            if (progAddr == getRegister(PC)) printf("  <== PC");
+/**
+ * Runs the w command: adds a watchpoint from its arguments, "<start> [end] [r|w|rw]", or
+ * lists the watchpoints if there are none.
+ * @param vm the VM
+ * @param args the rest of the command line, without the newline
+ */
+void watchCommand(SsamVm *vm, char *args) {
+    char *startText = strtok(args, " ");
+    if (!startText) {
+        int count = vm->watch ? vm->watch->count : 0;
+        if (count == 0) printf("No watchpoints are set.\n");
+        for (int i = 0; i < count; i++) {
+            const Watchpoint *point = &vm->watch->points[i];
+            printf("%d: 0x%04hx-0x%04hx %s%s\n", i, point->start, point->end,
+                   point->mode & WATCH_READ ? "r" : "", point->mode & WATCH_WRITE ? "w" : "");
         }
+        return;
+    }
 
-        printf("\n"); // New row
-        stackAddr += 2;
-        progAddr += 2;
+    unsigned short start = strtol(startText, NULL, 16);
+    unsigned short end = start == 0xFFFF ? start : start + 1; // one word by default, within memory
+    unsigned char mode = WATCH_READ | WATCH_WRITE;
+    for (char *arg = strtok(NULL, " "); arg; arg = strtok(NULL, " ")) {
+        if (strcmp(arg, "r") == 0) mode = WATCH_READ;
+        else if (strcmp(arg, "w") == 0) mode = WATCH_WRITE;
+        else if (strcmp(arg, "rw") == 0) mode = WATCH_READ | WATCH_WRITE;
+        else end = strtol(arg, NULL, 16);
+    }
+    if (end < start) {
+        fprintf(stderr, "Error: watchpoint 0x%04hx-0x%04hx ends before it starts.\n", start, end);
+    } else if (!addWatchpoint(vm, start, end, mode)) {
+        fprintf(stderr, "Error: no more than %d watchpoints can be set.\n", WATCH_MAX);
+    } else {
+        printf("Watching 0x%04hx-0x%04hx.\n", start, end);
     }
 }
 
-void logState(FILE *logFile, int originalBP, int originalPC) {
-    // Print error and halt statuses
-    if (errorOccurred() && haltReached()) fprintf(logFile, "[ERROR]      [HALT]\n\n");
-    else if (errorOccurred()) fprintf(logFile, "[ERROR]\n\n");
-    else if (haltReached()) fprintf(logFile, "[HALT]\n\n");
-
-    // Headers for table
-    fprintf(logFile, " REGISTERS                MEMORY                PROGRAM MEMORY\n");
-    fprintf(logFile, "----------------------------------------------------------------------\n");
-
-    short regCounter = 0;
-    int stackAddr = originalBP;
-    int progAddr = originalPC;
-
-    for (int i = 0; i < getRegister(BP); i++) {
-        // Print registers
-        if (regCounter < 9) {
-            const char* registerNames[] = {"R0", "R1", "R2", "R3", "AC", "SP", "BP", "PC", "IR"};
-            fprintf(logFile, "%-3s: 0x%04hx          ", registerNames[regCounter], getRegister(regCounter));
-            regCounter++;
-        } else {
-            fprintf(logFile, "                     "); // Empty space when there are no more registers to iterate through
+/**
+ * Prints the access that hit a watchpoint, if the last instruction run hit one.
+ * @param vm the VM
+ */
+void reportWatch(SsamVm *vm) {
+    if (!vm->watch || !vm->watch->hit) return;
+    const WatchList *watch = vm->watch;
+    printf("Watchpoint %d hit: %s 0x%04hx by PC: 0x%04hx IR: 0x%04hx\n", watch->hitIndex,
+           watch->hitWrite ? "store to" : "load from", watch->hitAddress, watch->hitPC, watch->hitIR);
+}
+
+/**
+ * Runs the b command: sets a breakpoint at an address, with the condition after "if" if
+ * there is one, or lists the breakpoints with no arguments.
+ * @param vm the VM
+ * @param args the rest of the command line, without its newline
+ */
+void breakCommand(SsamVm *vm, char *args) {
+    while (*args == ' ') args++;
+    if (*args == '\0') {
+        int count = vm->breaks ? vm->breaks->count : 0;
+        if (count == 0) printf("No breakpoints are set.\n");
+        for (int i = 0; i < count; i++) {
+            const Breakpoint *point = &vm->breaks->points[i];
+            printf("%d: 0x%04hx%s%s\n", i, point->address, point->length ? " if " : "", point->text);
         }
+        return;
+    }
 
-        // Print stack memory
-        fprintf(logFile, "0x%04hx: 0x%04hx", stackAddr, getWord(stackAddr));
-        if (stackAddr == getRegister(SP)) fprintf(logFile, "  [SP]       ");
-        else if (stackAddr == getRegister(BP)) fprintf(logFile, "  [BP]       ");
-        else fprintf(logFile, "             ");
+    char *rest;
+    unsigned short address = strtol(args, &rest, 16);
+    while (*rest == ' ') rest++;
+    const char *condition = NULL;
+    if (strncmp(rest, "if ", 3) == 0) condition = rest + 3;
+    else if (*rest != '\0') {
+        fprintf(stderr, "Error: expected \"if <condition>\" after the breakpoint's address.\n");
+        return;
+    }
 
-        // Print program memory
-        if (progAddr < originalPC + 40) {
-            fprintf(logFile, "0x%04hx: 0x%04hx", progAddr, getWord(progAddr));
-            if (progAddr == getRegister(PC)) fprintf(logFile, "  <== PC");
-        }
+    const char *error;
+    if (addBreakpoint(vm, address, condition, &error)) printf("Breakpoint set at 0x%04hx.\n", address);
+    else fprintf(stderr, "Error: can't set the breakpoint: %s.\n", error);
+}
 
-        fprintf(logFile, "\n"); // New row
-        stackAddr += 2;
-        progAddr += 2;
+/**
+ * Prints the breakpoint a run stopped at.
+ * @param vm the VM
+ * @param status how the run ended
+ */
+void reportBreak(SsamVm *vm, RunStatus status) {
+    if (status != RUN_BREAK) return;
+    printf("Breakpoint %d hit at 0x%04hx\n", vm->breaks->hitIndex, vm->R[PC]);
+}
+
+/**
+ * Reads the next line of commands, from the --commands text if there is one, or else from
+ * input. The line always ends with '\n', even if the input's last line didn't.
+ * @param buffer where to put the line
+ * @param size the size of buffer
+ * @param input the file to read lines from
+ * @param commands the --commands text still to run, or NULL. Lines in it end at ';' or a
+ *                 newline, and it is advanced past the line read.
+ * @return 1 if a line was read, or 0 once the commands or input have run out
+ */
+int nextCommandLine(char *buffer, int size, FILE *input, const char **commands) {
+    if (*commands) {
+        if (**commands == '\0') return 0;
+        int length = 0;
+        while ((*commands)[length] && (*commands)[length] != ';' && (*commands)[length] != '\n' && length < size - 2) length++;
+        memcpy(buffer, *commands, length);
+        *commands += length;
+        if (**commands == ';' || **commands == '\n') (*commands)++;
+        buffer[length] = '\n';
+        buffer[length + 1] = '\0';
+        return 1;
     }
+
+    if (!fgets(buffer, size - 1, input)) return 0;
+    size_t length = strcspn(buffer, "\n");
+    buffer[length] = '\n';
+    buffer[length + 1] = '\0';
+    return 1;
 }
 
 int main(int argc, char *argv[]) {
@@ -121,41 +196,256 @@ int main(int argc, char *argv[]) {
     // - bin file
     // - sp
     // - pc
+    // or, to run many programs at once:
+    // - --batch <manifest> [threads] [--budget=<instructions>] [--timeout=<seconds>]
+    // or, to run one program over many inputs:
+    // - --lockstep <file.bin> <sp> <pc> <inputs>
+    // Options for a single program come before the bin file:
+    // - --profile: count every instruction run, and report hotspots at halt
+    // - --record[=entries]: record execution so u and U can run it backwards
+    // - --devices[=base]: map the console, cycle counter and exit ports (see device.h)
+    // - --trace <file>: write a binary trace of every instruction run (see trace.h)
+    // - --trace-policy=<block|drop>: whether tracing waits or drops records when the
+    //   trace's writer thread falls behind
+    // - --script <file>: read commands from file ("-" for stdin) instead of the prompt
+    // - --commands <lines>: run the given commands, with lines separated by ';'
+    // - --display=<full|window|delta>: how d and N show the state
+    // - --format=<text|json|binary>: the form of Q's log and of the full display
+    // - --range=<start>-<end>: memory to include in JSON and binary states (repeatable)
+    // - --budget=<instructions>: stop H after running this many instructions
+    // - --timeout=<seconds>: stop H once it has run this long
+    // - --detect-loops: stop H when the program is in a loop it can never leave
+    // or, to pick up a run saved with S:
+    // - --resume <checkpoint>
 
-    if(argc < 4) {
-        fprintf(stderr, "Usage: ./vm <file.bin> <stack pointer start> <program counter start>\n");
-        return 0;
+    if (argc >= 3 && strcmp(argv[1], "--batch") == 0) {
+        // The thread count and the limits on each job may follow the manifest, in any order
+        RunLimits jobLimits = {0, 0};
+        int threads = 0;
+        for (int i = 3; i < argc; i++) {
+            if (strncmp(argv[i], "--budget=", 9) == 0 && strtoull(argv[i] + 9, NULL, 10) > 0) {
+                jobLimits.budget = strtoull(argv[i] + 9, NULL, 10);
+            } else if (strncmp(argv[i], "--timeout=", 10) == 0 && strtod(argv[i] + 10, NULL) > 0) {
+                jobLimits.timeout = strtod(argv[i] + 10, NULL);
+            } else if (strncmp(argv[i], "--", 2) != 0) {
+                threads = atoi(argv[i]);
+            } else {
+                fprintf(stderr, "Error: unrecognized option \"%s\".\n", argv[i]);
+                return 1;
+            }
+        }
+        return runBatch(argv[2], threads, &jobLimits);
+    }
+    if (argc >= 6 && strcmp(argv[1], "--lockstep") == 0) {
+        return runLockstep(argv[2], strToHex(argv[3]), strToHex(argv[4]), argv[5]);
+    }
+
+    int profiling = 0;
+    int undoEntries = 0;
+    int devices = 0;
+    unsigned short deviceBase = DEVICE_BASE;
+    const char *resumePath = NULL;
+    const char *scriptPath = NULL;
+    const char *commands = NULL;
+    const char *tracePath = NULL;
+    WriterPolicy tracePolicy = WRITER_BLOCK;
+    DisplayMode displayMode = DISPLAY_FULL;
+    StateLayout layout = {.format = FORMAT_TEXT};
+    RunLimits limits = {0, 0};
+    int detectLoops = 0;
+    while (argc > 1 && strncmp(argv[1], "--", 2) == 0) {
+        if (strcmp(argv[1], "--profile") == 0) {
+            profiling = 1;
+        } else if (strcmp(argv[1], "--record") == 0) {
+            undoEntries = UNDO_DEFAULT_ENTRIES;
+        } else if (strncmp(argv[1], "--record=", 9) == 0 && atoi(argv[1] + 9) > 0) {
+            undoEntries = atoi(argv[1] + 9);
+        } else if (strcmp(argv[1], "--devices") == 0) {
+            devices = 1;
+        } else if (strncmp(argv[1], "--devices=", 10) == 0) {
+            devices = 1;
+            long base = strtol(argv[1] + 10, NULL, 16);
+            if (base < 0 || base > 0xFFFF - PORT_EXIT - 0x01) {
+                fprintf(stderr, "Error: device base \"%s\" leaves no room for the ports below 0x10000.\n", argv[1] + 10);
+                return 1;
+            }
+            deviceBase = base;
+        } else if (strcmp(argv[1], "--resume") == 0 && argc > 2) {
+            resumePath = argv[2];
+            argv++;
+            argc--;
+        } else if (strncmp(argv[1], "--display=", 10) == 0 && parseDisplayMode(argv[1] + 10, &displayMode)) {
+            // nothing else to do
+        } else if (strncmp(argv[1], "--format=", 9) == 0 && parseStateFormat(argv[1] + 9, &layout.format)) {
+            // nothing else to do
+        } else if (strncmp(argv[1], "--range=", 8) == 0 && strchr(argv[1] + 8, '-') && layout.rangeCount < STATE_RANGES_MAX) {
+            MemoryRange *range = &layout.ranges[layout.rangeCount++];
+            range->start = strtol(argv[1] + 8, NULL, 16);
+            range->end = strtol(strchr(argv[1] + 8, '-') + 1, NULL, 16);
+            if (range->end < range->start) {
+                fprintf(stderr, "Error: range \"%s\" ends before it starts.\n", argv[1] + 8);
+                return 1;
+            }
+        } else if (strncmp(argv[1], "--budget=", 9) == 0 && strtoull(argv[1] + 9, NULL, 10) > 0) {
+            limits.budget = strtoull(argv[1] + 9, NULL, 10);
+        } else if (strncmp(argv[1], "--timeout=", 10) == 0 && strtod(argv[1] + 10, NULL) > 0) {
+            limits.timeout = strtod(argv[1] + 10, NULL);
+        } else if (strcmp(argv[1], "--detect-loops") == 0) {
+            detectLoops = 1;
+        } else if (strcmp(argv[1], "--trace") == 0 && argc > 2) {
+            tracePath = argv[2];
+            argv++;
+            argc--;
+        } else if (strcmp(argv[1], "--trace-policy=block") == 0) {
+            tracePolicy = WRITER_BLOCK;
+        } else if (strcmp(argv[1], "--trace-policy=drop") == 0) {
+            tracePolicy = WRITER_DROP;
+        } else if (strcmp(argv[1], "--script") == 0 && argc > 2) {
+            scriptPath = argv[2];
+            argv++;
+            argc--;
+        } else if (strcmp(argv[1], "--commands") == 0 && argc > 2) {
+            commands = argv[2];
+            argv++;
+            argc--;
+        } else {
+            fprintf(stderr, "Error: unrecognized option \"%s\".\n", argv[1]);
+            return 1;
+        }
+        argv++;
+        argc--;
     }
 
+    if(argc < 4 && !resumePath) {
+        fprintf(stderr, "Usage: ./vm [options] <file.bin> <stack pointer start> <program counter start>\n");
+        fprintf(stderr, "       ./vm [options] --resume <checkpoint>\n");
+        fprintf(stderr, "       ./vm --batch <manifest> [threads] [--budget=<instructions>] [--timeout=<seconds>]\n");
+        fprintf(stderr, "       ./vm --lockstep <file.bin> <stack pointer start> <program counter start> <inputs>\n");
+        fprintf(stderr, "Options: --profile --record[=entries] --devices[=base] --display=<full|window|delta>\n");
+        fprintf(stderr, "         --format=<text|json|binary> --range=<start>-<end>\n");
+        fprintf(stderr, "         --budget=<instructions> --timeout=<seconds> --detect-loops\n");
+        fprintf(stderr, "         --trace <file> --trace-policy=<block|drop> --script <file> --commands <lines>\n");
+        return 1;
+    }
 
-    printf("Initializing...\n");
+    // Commands from a script or the command line run without the prompt or banner
+    FILE *input = stdin;
+    int interactive = !scriptPath && !commands;
+    if (scriptPath && strcmp(scriptPath, "-") != 0) {
+        input = fopen(scriptPath, "r");
+        if (!input) {
+            fprintf(stderr, "Error: script \"%s\" could not be opened.\n", scriptPath);
+            return 1;
+        }
+    }
 
-    int sp = strToHex(argv[2]), pc = strToHex(argv[3]);
+    if (interactive) printf("Initializing...\n");
 
     // initialize the VCPU
-    controllerInit(sp, pc);
-    printf("Stack Pointer: %hi / Base Pointer: %hi / Program Counter: %hi\n", getRegister(SP), getRegister(BP), getRegister(PC));
+    SsamVm *vm = createVm();
+    if (!vm) {
+        fprintf(stderr, "Error: could not allocate the VM.\n");
+        return 1;
+    }
+
+    int sp, pc;
+    if (resumePath) {
+        // Pick up where a checkpoint left off
+        unsigned short startSP, startPC;
+        if (loadCheckpoint(vm, resumePath, &startSP, &startPC)) {
+            destroyVm(vm);
+            return 1;
+        }
+        sp = startSP;
+        pc = startPC;
+        if (interactive) printf("Resuming from \"%s\" at Program Counter: %hi\n", resumePath, getRegister(vm, PC));
+    } else {
+        sp = strToHex(argv[2]);
+        pc = strToHex(argv[3]);
+        controllerInit(vm, sp, pc);
+        if (interactive) printf("Stack Pointer: %hi / Base Pointer: %hi / Program Counter: %hi\n", getRegister(vm, SP), getRegister(vm, BP), getRegister(vm, PC));
+
+        // Load program code into memory (init VRAM)
+        FILE *binary = fopen(argv[1], "rb");
+        if(!binary) {
+            fprintf(stderr, "Error: specified binary file \"%s\" could not be loaded.\n", argv[1]);
+            destroyVm(vm);
+            return 1;
+        }
+
+        if (interactive) printf("Loading program \"%s\"\n", argv[1]);
+        int programSize = loadProgram(vm, binary);
+        fclose(binary);
+        if (programSize < 0) {
+            fprintf(stderr, "Error: specified binary file \"%s\" could not be loaded.\n", argv[1]);
+            destroyVm(vm);
+            return 1;
+        }
+
+        // Decode the program ahead of time, fusing common instruction pairs
+        if (programSize > pc) predecode(vm, pc, programSize);
+    }
+
+    if (profiling && !enableProfile(vm)) {
+        fprintf(stderr, "Error: profiling isn't available (build with -DSSAM_PROFILE=ON).\n");
+        destroyVm(vm);
+        return 1;
+    }
+
+    if (undoEntries && !enableUndo(vm, undoEntries)) {
+        fprintf(stderr, "Error: could not allocate the undo log.\n");
+        destroyVm(vm);
+        return 1;
+    }
+
+    if (devices && !mapStandardDevices(vm, deviceBase, stdout)) {
+        fprintf(stderr, "Error: could not map the devices.\n");
+        destroyVm(vm);
+        return 1;
+    }
 
-    // Load program code into memory (init VRAM)
-    FILE *binary = fopen(argv[1], "rb");
-    if(!binary) {
-        fprintf(stderr, "Error: specified binary file \"%s\" could not be loaded.\n", argv[1]);
-        return 0;
+    if (detectLoops && devices) {
+        fprintf(stderr, "Error: --detect-loops can't be used with --devices, which the program's next state depends on.\n");
+        destroyVm(vm);
+        return 1;
+    }
+    if (detectLoops && !enableLoopDetection(vm)) {
+        fprintf(stderr, "Error: could not allocate the loop detector.\n");
+        destroyVm(vm);
+        return 1;
     }
 
-    printf("Loading program \"%s\"\n", argv[1]);
-    loadProgram(binary);
-    fclose(binary);
+    if (tracePath && !enableTrace(vm, tracePath, tracePolicy)) {
+        fprintf(stderr, "Error: trace file \"%s\" could not be opened.\n", tracePath);
+        destroyVm(vm);
+        return 1;
+    }
+
+    layout.originalBP = sp - 0x02;
+    layout.originalPC = pc;
+
+    StateDisplay *display = createDisplay(displayMode);
+    if (!display) {
+        fprintf(stderr, "Error: could not allocate the display.\n");
+        destroyVm(vm);
+        return 1;
+    }
 
-    printf("Welcome to SSAM VM.\n\n");
+    if (interactive) printf("Welcome to SSAM VM.\n\n");
 
     FILE *file;
+    int profileReported = 0;
 
     while(1) {
-        // Accept a new command
+        // Accept a new command. Running out of commands quits, like q.
         char buffer[BUFFER_SIZE];
-        printf("> ");
-        fgets(buffer, BUFFER_SIZE, stdin);
+        if (vm->devices) flushDevices(vm);
+        if (vm->trace && !flushTrace(vm)) fprintf(stderr, "Error: the trace could not be written.\n");
+        if (interactive) printf("> ");
+        if (!nextCommandLine(buffer, BUFFER_SIZE, input, &commands)) {
+            if (interactive) printf("\n");
+            strcpy(buffer, "q\n");
+        }
 
         int i = 0;
         while (buffer[i] != '\n') {
@@ -163,42 +453,132 @@ int main(int argc, char *argv[]) {
             switch(buffer[i]) {
                 case 'Q':
                     // Open the file dump_log.txt and log the VM state to it.
-                    file = fopen("dump_log.txt", "w");
+                    file = fopen("dump_log.txt", "wb");
                     if(!file) {
                         fprintf(stderr, "Error: dump_log.txt could not be opened.\n");
-                        return 0;
+                        destroyVm(vm);
+                        destroyDisplay(display);
+                        if (input != stdin) fclose(input);
+                        return 1;
                     }
-                    logState(file, sp - 0x02, pc);
+                    writeState(vm, file, &layout);
                     fclose(file);
-                case 'q':
-                    // Quit if 'q' and after dumping to dump_log.txt for 'Q'
-                    return 0;
+                case 'q': {
+                    // Quit if 'q' and after dumping to dump_log.txt for 'Q', with the exit
+                    // code the program gave the exit port, if any. A script whose last run
+                    // a limit or loop stopped exits with 1, as --batch does.
+                    int exitCode = vm->devices && vm->devices->exited ? vm->devices->exitCode : 0;
+                    if (!interactive && vm->stopped) exitCode = 1;
+                    if (vm->trace && vm->trace->dropped) {
+                        fprintf(stderr, "Warning: the trace dropped %llu of %llu instructions.\n",
+                                vm->trace->dropped, vm->trace->records);
+                    }
+                    destroyVm(vm);
+                    destroyDisplay(display);
+                    if (input != stdin) fclose(input);
+                    return exitCode;
+                }
                 case 'd':
                     // Print the state to the console
-                    printState(sp - 0x02, pc);
+                    dumpState(vm, display, &layout);
                     break;
                 case 'n':
                     // Run one fetch-execute cycle
-                    fetch();
-                    execute();
+                    fetch(vm);
+                    execute(vm);
+                    reportWatch(vm);
                     break;
                 case 'N':
                     // Run one fetch-execute cycle, then print the VM state
-                    fetch();
-                    execute();
-                    printState(sp - 0x02, pc);
+                    fetch(vm);
+                    execute(vm);
+                    reportWatch(vm);
+                    dumpState(vm, display, &layout);
+                    break;
+                case 'S': {
+                    // Save a checkpoint to the file named by the rest of the line
+                    char *path = buffer + i + 1;
+                    while (*path == ' ') path++;
+                    path[strcspn(path, "\n")] = '\0';
+                    if (*path == '\0') path = "checkpoint.ssck";
+                    if (!saveCheckpoint(vm, path, sp, pc)) printf("Saved checkpoint to \"%s\".\n", path);
+                    buffer[i + 1] = '\n'; // the rest of the line was the file name
+                    break;
+                }
+                case 'u':
+                    // Undo the last instruction run
+                    if (!vm->undo) fprintf(stderr, "Error: run with --record to step backwards.\n");
+                    else if (!reverseStep(vm)) printf("No earlier state is recorded.\n");
                     break;
-                case 'H':
-                    // Run fetch-execute cycles until halt is reached.
-                    while(!haltReached()) {
-                        fetch();
-                        execute();
+                case 'U':
+                    // Go back to the oldest recorded state
+                    if (!vm->undo) fprintf(stderr, "Error: run with --record to step backwards.\n");
+                    else printf("Stepped back %llu instructions.\n", reverseContinue(vm));
+                    break;
+                case 'H': {
+                    // Run fetch-execute cycles until halt is reached, a watchpoint or
+                    // breakpoint is hit, or a limit runs out. Errors don't stop the machine.
+                    RunStatus status = runLimited(vm, &limits);
+                    reportWatch(vm);
+                    reportBreak(vm, status);
+                    if (status == RUN_BUDGET) printf("Stopped: ran the budget of %llu instructions.\n", limits.budget);
+                    if (status == RUN_TIMEOUT) printf("Stopped: ran for the %g second timeout.\n", limits.timeout);
+                    if (status == RUN_LOOP) {
+                        const LoopDetector *loops = vm->loops;
+                        printf("Stopped: the program is in a loop it can never leave, at 0x%04hx-0x%04hx", loops->low, loops->high);
+                        if (loops->scanned < loops->period) {
+                            printf(" (as far as the %llu of its %llu instructions run to find out)", loops->scanned, loops->period);
+                        }
+                        printf(".\n");
                     }
                     break;
+                }
+                case 'w':
+                    // Add a watchpoint given by the rest of the line, or list them
+                    buffer[strcspn(buffer, "\n")] = '\0';
+                    watchCommand(vm, buffer + i + 1);
+                    buffer[i + 1] = '\n'; // the rest of the line was the arguments
+                    break;
+                case 'v': {
+                    // Switch how d and N show the state to the mode named by the rest of the line
+                    char *name = buffer + i + 1;
+                    while (*name == ' ') name++;
+                    name[strcspn(name, "\n")] = '\0';
+                    if (!parseDisplayMode(name, &display->mode)) {
+                        fprintf(stderr, "Error: unknown display mode \"%s\" (use full, window or delta).\n", name);
+                    }
+                    buffer[i + 1] = '\n'; // the rest of the line was the mode
+                    break;
+                }
+                case 'W':
+                    // Remove every watchpoint
+                    clearWatchpoints(vm);
+                    break;
+                case 'b':
+                    // Set a breakpoint given by the rest of the line, or list them
+                    buffer[strcspn(buffer, "\n")] = '\0';
+                    breakCommand(vm, buffer + i + 1);
+                    buffer[i + 1] = '\n'; // the rest of the line was the arguments
+                    break;
+                case 'B':
+                    // Remove every breakpoint
+                    clearBreakpoints(vm);
+                    break;
                 default:
                     fprintf(stderr, "Error: Unrecognized command \"%c\". Check the README.md file for the list of commands.\n", buffer[i]);
+                    if (!interactive) {
+                        // A script can't react to the error, so don't run the rest of it
+                        destroyVm(vm);
+                        destroyDisplay(display);
+                        if (input != stdin) fclose(input);
+                        return 1;
+                    }
                     break;
             }
+            if (vm->profile && haltReached(vm) && !profileReported) {
+                printProfile(vm->profile, stdout);
+                profileReported = 1;
+            }
             i++;
         }
 
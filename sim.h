@@ -4,20 +4,25 @@
 #ifndef SIM_H
 #define SIM_H
 
+#include "vm.h"
 #include <stdio.h>
 
 /**
- * Prints to the console the current state of the VM.
+ * Prints to the console the current state of the VM, as the text table written by
+ * writeState() (see format.h).
+ *
+ * @param vm the VM to print
  */
-void printState(int originalBP, int originalPC);
+void printState(SsamVm *vm, int originalBP, int originalPC);
 
 /**
  * Logs the current VM state to the given logFile. This gives the same information as
  * printState(), but directs it to the specified logFile.
  *
+ * @param vm the VM to log
  * @param logFile the file to log the state to
  */
-void logState(FILE *logFile, int originalBP, int originalPC);
+void logState(SsamVm *vm, FILE *logFile, int originalBP, int originalPC);
 
 /**
  * The entry point of the VM. Loads in the specified code, then accepts user input to
@@ -0,0 +1,64 @@
+// Snapshots of a VM's registers and memory that can be restored cheaply.
+// Created by Jackson Eshbaugh on 16.10.2026.
+
+#include "snapshot.h"
+#include "controller.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Makes a snapshot the one the VM tracks, with every page clean.
+ * @param vm the VM
+ * @param snapshot the snapshot, which must match the VM's memory
+ */
+void trackSnapshot(SsamVm *vm, const VmSnapshot *snapshot) {
+    for (int page = 0; page < PAGE_COUNT; page++) vm->pageFlags[page] |= PAGE_CLEAN;
+    vm->dirtyCount = 0;
+    vm->tracked = snapshot;
+}
+
+VmSnapshot *takeSnapshot(SsamVm *vm) {
+    VmSnapshot *snapshot = malloc(sizeof(VmSnapshot));
+    if (!snapshot) return NULL;
+
+    memcpy(snapshot->R, vm->R, sizeof(vm->R));
+    snapshot->flags = vm->flags;
+    memcpy(snapshot->memory, vm->memory, MEMORY_SIZE);
+    trackSnapshot(vm, snapshot);
+    return snapshot;
+}
+
+void restoreSnapshot(SsamVm *vm, const VmSnapshot *snapshot) {
+    if (vm->tracked == snapshot) {
+        for (int i = 0; i < vm->dirtyCount; i++) {
+            unsigned short page = vm->dirtyPages[i];
+            unsigned short start = page << PAGE_SHIFT;
+            memcpy(vm->memory + start, snapshot->memory + start, PAGE_BYTES);
+
+            // Anything decoded from the page may have been decoded from what was written
+            if (vm->pageFlags[page] & PAGE_CODE) {
+                for (int offset = 0; offset < PAGE_BYTES; offset += 0x02) invalidateDecoded(vm, start + offset);
+            }
+            vm->pageFlags[page] = (vm->pageFlags[page] | PAGE_CLEAN) & ~PAGE_HASHED;
+        }
+        vm->dirtyCount = 0;
+    } else {
+        memcpy(vm->memory, snapshot->memory, MEMORY_SIZE);
+        resetDecoded(vm);
+        trackSnapshot(vm, snapshot);
+        for (int page = 0; page < PAGE_COUNT; page++) vm->pageFlags[page] &= ~PAGE_HASHED;
+    }
+
+    memcpy(vm->R, snapshot->R, sizeof(vm->R));
+    vm->flags = snapshot->flags;
+    vm->current = 0;
+}
+
+void destroySnapshot(SsamVm *vm, VmSnapshot *snapshot) {
+    if (vm->tracked == snapshot) {
+        for (int page = 0; page < PAGE_COUNT; page++) vm->pageFlags[page] &= ~PAGE_CLEAN;
+        vm->dirtyCount = 0;
+        vm->tracked = NULL;
+    }
+    free(snapshot);
+}
@@ -0,0 +1,43 @@
+// Snapshots of a VM's registers and memory that can be restored cheaply.
+// Created by Jackson Eshbaugh on 16.10.2026.
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "vm.h"
+
+/**
+ * A saved copy of a VM's registers, flags and memory.
+ */
+struct VmSnapshot {
+    unsigned short R[REG_COUNT];
+    char flags;
+    unsigned char memory[MEMORY_SIZE];
+};
+
+/**
+ * Saves the VM's state, and starts tracking which pages it writes from now on, so that
+ * restoring this snapshot only has to copy those pages back. A VM tracks one snapshot at
+ * a time: the one most recently taken or restored.
+ * @param vm the VM
+ * @return the snapshot, or NULL if it could not be allocated
+ */
+VmSnapshot *takeSnapshot(SsamVm *vm);
+
+/**
+ * Puts the VM back in the state a snapshot saved. If the VM is tracking the snapshot,
+ * only the pages written since it was taken (or last restored) are copied; otherwise all
+ * of memory is, and the VM starts tracking it.
+ * @param vm the VM
+ * @param snapshot the snapshot to restore
+ */
+void restoreSnapshot(SsamVm *vm, const VmSnapshot *snapshot);
+
+/**
+ * Frees a snapshot, and stops the VM tracking it.
+ * @param vm the VM the snapshot was taken from
+ * @param snapshot the snapshot to free
+ */
+void destroySnapshot(SsamVm *vm, VmSnapshot *snapshot);
+
+#endif //SNAPSHOT_H
@@ -0,0 +1,397 @@
+// Ahead-of-time translator from an SSAM binary to a C program that runs it natively.
+// Created by Jackson Eshbaugh on 16.10.2026.
+//
+// Usage: ./ssam2c <file.bin> <0xinitial-base-pointer> <0xinitial-program-counter> [out.c]
+//
+// Every instruction reachable from the entry PC becomes a labelled block of straight-line
+// C, with jumps and calls as gotos. Anything that jumps through a register (ret, or a load
+// into PC) goes through a switch over every translated address. If the program jumps
+// somewhere that wasn't translated, or writes over translated code, the rest of the run
+// falls back to an interpreter built into the generated program. When the program halts,
+// it prints its final state in the same format as the VM's Q dump.
+
+#include "controller.h"
+#include "decode.h"
+#include "image.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+const char *registerNames[] = {"R0", "R1", "R2", "R3", "AC", "SP", "BP", "PC", "IR"};
+
+unsigned char image[MEMORY_SIZE];
+int imageSize;
+
+unsigned char reachable[MEMORY_SIZE]; // 1 for each address an instruction is translated at
+unsigned char code[MEMORY_SIZE]; // 1 for each byte covered by a translated instruction
+
+// The interpreter the generated program falls back to. It works like execute().
+const char *fallbackSource =
+    "static unsigned short rd(unsigned short a) { return M[a] << 8 | M[(unsigned short) (a + 1)]; }\n"
+    "static void wr(unsigned short a, unsigned short v) { M[a] = v >> 8; M[(unsigned short) (a + 1)] = v & 0xFF; }\n"
+    "\n"
+    "// Runs until a halt is reached, like H does.\n"
+    "static void interpret(unsigned short *r, unsigned char *flags) {\n"
+    "    while (!(*flags & 0x1)) {\n"
+    "        unsigned short w = rd(r[7]);\n"
+    "        r[8] = w;\n"
+    "        r[7] += 0x02;\n"
+    "        int a = (w & 0x0700) >> 8, b = (w & 0x00e0) >> 5;\n"
+    "        short imm = (signed char) (w & 0x00ff), offset = w & 0x001f;\n"
+    "        if (offset & 0x10) offset -= 32;\n"
+    "        switch (w & 0xc000) {\n"
+    "            case 0x0000:\n"
+    "                switch (w & 0x1800) {\n"
+    "                    case 0x0000: *flags |= 0x1; break;\n"
+    "                    case 0x0800: break;\n"
+    "                    case 0x1000: r[5] = r[6]; r[6] = rd(r[5]); r[5] -= 0x02; r[7] = rd(r[5]); break;\n"
+    "                    default: *flags |= 0x2; break;\n"
+    "                }\n"
+    "                break;\n"
+    "            case 0x4000:\n"
+    "                switch (w & 0x3800) {\n"
+    "                    case 0x0000: r[a] = imm; break;\n"
+    "                    case 0x0800: r[a] = rd(imm); break;\n"
+    "                    case 0x1000: r[a] = rd(b); break;\n"
+    "                    case 0x1800: r[a] = rd(r[b] + offset); break;\n"
+    "                    case 0x2000: wr(imm, r[a]); break;\n"
+    "                    case 0x2800: wr(r[b], r[a]); break;\n"
+    "                    case 0x3000: wr(r[b] + offset, r[a]); break;\n"
+    "                    default: *flags |= 0x2; break;\n"
+    "                }\n"
+    "                break;\n"
+    "            case 0x8000:\n"
+    "                switch (w & 0x3800) {\n"
+    "                    case 0x0000: r[4] = -r[a]; break;\n"
+    "                    case 0x0800: r[4] = r[a] + r[b]; break;\n"
+    "                    case 0x1000: r[4] = r[a] + imm; break;\n"
+    "                    case 0x1800: r[4] = r[a] - r[b]; break;\n"
+    "                    case 0x2000: r[4] = r[a] - imm; break;\n"
+    "                    case 0x3800: r[a] = r[b]; break;\n"
+    "                    default: *flags |= 0x2; break;\n"
+    "                }\n"
+    "                break;\n"
+    "            default:\n"
+    "                switch (w & 0x3000) {\n"
+    "                    case 0x0000: r[7] = w & 0x0fff; break;\n"
+    "                    case 0x1000: if (r[4] == 0x0000) r[7] = w & 0x0fff; break;\n"
+    "                    case 0x2000: if ((short) r[4] < 0) r[7] = w & 0x0fff; break;\n"
+    "                    default:\n"
+    "                        wr(r[5], r[7]); r[5] += 0x02; r[7] = w & 0x0fff;\n"
+    "                        wr(r[5], r[6]); r[6] = r[5]; r[5] += 0x02;\n"
+    "                        break;\n"
+    "                }\n"
+    "                break;\n"
+    "        }\n"
+    "    }\n"
+    "}\n"
+    "\n";
+
+// Prints the final state exactly like logState() does.
+const char *dumpSource =
+    "static void dumpState(const unsigned short *r, unsigned char flags, int originalBP, int originalPC) {\n"
+    "    if ((flags & 0x2) && (flags & 0x1)) printf(\"[ERROR]      [HALT]\\n\\n\");\n"
+    "    else if (flags & 0x2) printf(\"[ERROR]\\n\\n\");\n"
+    "    else if (flags & 0x1) printf(\"[HALT]\\n\\n\");\n"
+    "    printf(\" REGISTERS                MEMORY                PROGRAM MEMORY\\n\");\n"
+    "    printf(\"----------------------------------------------------------------------\\n\");\n"
+    "    const char *registerNames[] = {\"R0\", \"R1\", \"R2\", \"R3\", \"AC\", \"SP\", \"BP\", \"PC\", \"IR\"};\n"
+    "    int stackAddr = originalBP, progAddr = originalPC;\n"
+    "    for (int i = 0, regCounter = 0; i < r[6]; i++) {\n"
+    "        if (regCounter < 9) {\n"
+    "            printf(\"%-3s: 0x%04hx          \", registerNames[regCounter], r[regCounter]);\n"
+    "            regCounter++;\n"
+    "        } else {\n"
+    "            printf(\"                     \");\n"
+    "        }\n"
+    "        printf(\"0x%04hx: 0x%04hx\", stackAddr, rd(stackAddr));\n"
+    "        if (stackAddr == r[5]) printf(\"  [SP]       \");\n"
+    "        else if (stackAddr == r[6]) printf(\"  [BP]       \");\n"
+    "        else printf(\"             \");\n"
+    "        if (progAddr < originalPC + 40) {\n"
+    "            printf(\"0x%04hx: 0x%04hx\", progAddr, rd(progAddr));\n"
+    "            if (progAddr == r[7]) printf(\"  <== PC\");\n"
+    "        }\n"
+    "        printf(\"\\n\");\n"
+    "        stackAddr += 2;\n"
+    "        progAddr += 2;\n"
+    "    }\n"
+    "}\n"
+    "\n";
+
+/**
+ * Reads the instruction word at address from the program image.
+ * @param address the address to read
+ * @return the word at address
+ */
+unsigned short imageWord(unsigned short address) {
+    return image[address] << 8 | image[(unsigned short) (address + 1)];
+}
+
+/**
+ * Determines if an instruction writes PC through a register operand, making it an
+ * indirect jump.
+ * @param d the instruction
+ * @return 1 if d writes PC other than by jmp, jmpz, jmpn, call or ret
+ */
+int writesPC(const DecodedInstruction *d) {
+    switch (d->op) {
+        case OP_LODI:
+        case OP_LODA:
+        case OP_LODR:
+        case OP_LODRD:
+        case OP_MOV:
+            return d->regA == PC;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Marks every instruction reachable from entry, following fall-through, jump and call
+ * targets, and the return point after each call.
+ * @param entry the initial program counter
+ */
+void findReachable(unsigned short entry) {
+    static unsigned short worklist[MEMORY_SIZE];
+    int count = 0;
+    worklist[count++] = entry;
+    reachable[entry] = 1;
+
+    while (count > 0) {
+        unsigned short address = worklist[--count];
+        DecodedInstruction d;
+        decodeInstruction(imageWord(address), &d);
+        code[address] = 1;
+        code[(unsigned short) (address + 1)] = 1;
+
+        unsigned short successors[2];
+        int successorCount = 0;
+        int fallsThrough = d.op != OP_HALT && d.op != OP_RET && d.op != OP_JMP && !writesPC(&d);
+        if (fallsThrough) successors[successorCount++] = address + 0x02;
+        if (d.op == OP_JMP || d.op == OP_JMPZ || d.op == OP_JMPN || d.op == OP_CALL) {
+            successors[successorCount++] = d.imm;
+        } else if (d.op == OP_LODI && d.regA == PC) {
+            successors[successorCount++] = d.imm; // a constant jump, though it's dispatched
+        }
+
+        for (int i = 0; i < successorCount; i++) {
+            if (!reachable[successors[i]]) {
+                reachable[successors[i]] = 1;
+                worklist[count++] = successors[i];
+            }
+        }
+    }
+}
+
+/**
+ * Writes the C for a store of value to address, followed by a jump to the fallback
+ * interpreter if it wrote over translated code.
+ * @param out the file to write to
+ * @param address a C expression for the address
+ * @param value a C expression for the value
+ * @param constant 1 if address is a constant known at translation time
+ * @param constantAddress the address, if constant
+ */
+void emitStore(FILE *out, const char *address, const char *value, int constant, unsigned short constantAddress) {
+    if (constant) {
+        fprintf(out, "    WR(%s, %s);\n", address, value);
+        if (code[constantAddress] || code[(unsigned short) (constantAddress + 1)]) {
+            fprintf(out, "    goto fallback;\n");
+        }
+    } else {
+        fprintf(out, "    { unsigned short a = %s; WR(a, %s); if (CODE[a] | CODE[(unsigned short) (a + 1)]) goto fallback; }\n",
+                address, value);
+    }
+}
+
+/**
+ * Writes the C for one instruction.
+ * @param out the file to write to
+ * @param address the address of the instruction
+ */
+void emitInstruction(FILE *out, unsigned short address) {
+    DecodedInstruction d;
+    decodeInstruction(imageWord(address), &d);
+    const char *a = registerNames[d.regA];
+    const char *b = registerNames[d.regB];
+    unsigned short imm = d.imm;
+    char expression[64];
+
+    fprintf(out, "L_%04x:\n    IR = 0x%04x; PC = 0x%04x;\n", address, d.word, (unsigned short) (address + 0x02));
+    switch (d.op) {
+        case OP_HALT:
+            fprintf(out, "    flags |= 0x1;\n    goto done;\n");
+            return;
+        case OP_NOP:
+            break;
+        case OP_RET:
+            fprintf(out, "    SP = BP; BP = RD(SP); SP = SP - 0x02; PC = RD(SP);\n    goto dispatch;\n");
+            return;
+        case OP_LODI:
+            fprintf(out, "    %s = 0x%04x;\n", a, imm);
+            break;
+        case OP_LODA:
+            fprintf(out, "    %s = RD(0x%04x);\n", a, imm);
+            break;
+        case OP_LODR:
+            fprintf(out, "    %s = RD(0x%04x);\n", a, d.regB); // same as lodr()
+            break;
+        case OP_LODRD:
+            fprintf(out, "    %s = RD(%s + %d);\n", a, b, d.imm);
+            break;
+        case OP_STOA:
+            snprintf(expression, sizeof(expression), "0x%04x", imm);
+            emitStore(out, expression, a, 1, imm);
+            break;
+        case OP_STOR:
+            emitStore(out, b, a, 0, 0);
+            break;
+        case OP_STORD:
+            snprintf(expression, sizeof(expression), "%s + %d", b, d.imm);
+            emitStore(out, expression, a, 0, 0);
+            break;
+        case OP_NEG:
+            fprintf(out, "    AC = -%s;\n", a);
+            break;
+        case OP_ADDR:
+            fprintf(out, "    AC = %s + %s;\n", a, b);
+            break;
+        case OP_ADDI:
+            fprintf(out, "    AC = %s + %d;\n", a, d.imm);
+            break;
+        case OP_SUBR:
+            fprintf(out, "    AC = %s - %s;\n", a, b);
+            break;
+        case OP_SUBI:
+            fprintf(out, "    AC = %s - %d;\n", a, d.imm);
+            break;
+        case OP_MOV:
+            fprintf(out, "    %s = %s;\n", a, b);
+            break;
+        case OP_JMP:
+            fprintf(out, "    PC = 0x%04x;\n    goto L_%04x;\n", imm, imm);
+            return;
+        case OP_JMPZ:
+            fprintf(out, "    if (AC == 0x0000) { PC = 0x%04x; goto L_%04x; }\n", imm, imm);
+            break;
+        case OP_JMPN:
+            fprintf(out, "    if ((short) AC < 0) { PC = 0x%04x; goto L_%04x; }\n", imm, imm);
+            break;
+        case OP_CALL:
+            // Both stores finish before the fallback check, so the call is never left half done
+            fprintf(out, "    { int hit = CODE[SP] | CODE[(unsigned short) (SP + 1)]; WR(SP, PC); SP = SP + 0x02; PC = 0x%04x;\n", imm);
+            fprintf(out, "      hit |= CODE[SP] | CODE[(unsigned short) (SP + 1)]; WR(SP, BP); BP = SP; SP = SP + 0x02;\n");
+            fprintf(out, "      if (hit) goto fallback; }\n    goto L_%04x;\n", imm);
+            return;
+        default:
+            fprintf(out, "    flags |= 0x2;\n");
+            break;
+    }
+
+    if (writesPC(&d)) {
+        fprintf(out, "    goto dispatch;\n");
+        return;
+    }
+    // Fall through to the next instruction, jumping to it unless it is emitted right after
+    // this one (it isn't if an instruction starts at address + 1).
+    unsigned short next = address + 0x02;
+    int following = address + 1;
+    while (following < MEMORY_SIZE && !reachable[following]) following++;
+    if (following != next) fprintf(out, "    goto L_%04x;\n", next);
+}
+
+/**
+ * Writes the whole generated program.
+ * @param out the file to write to
+ * @param source the path of the binary, for the header comment
+ * @param sp the initial stack pointer
+ * @param pc the initial program counter
+ */
+void emitProgram(FILE *out, const char *source, unsigned short sp, unsigned short pc) {
+    fprintf(out, "// Translated from %s by ssam2c (BP 0x%04x, PC 0x%04x).\n", source, sp, pc);
+    fprintf(out, "#include <stdio.h>\n#include <string.h>\n\n");
+    fprintf(out, "static unsigned char M[0x10000];\n");
+    fprintf(out, "#define RD(a) ((unsigned short) (M[(unsigned short) (a)] << 8 | M[(unsigned short) ((a) + 1)]))\n");
+    fprintf(out, "#define WR(a, v) do { unsigned short a_ = (a), v_ = (v); M[a_] = v_ >> 8; M[(unsigned short) (a_ + 1)] = v_ & 0xFF; } while (0)\n\n");
+
+    // The initial memory image, without trailing zeros
+    int size = imageSize;
+    while (size > 0 && image[size - 1] == 0) size--;
+    fprintf(out, "static const unsigned char IMAGE[%d] = {", size > 0 ? size : 1);
+    for (int i = 0; i < size; i++) fprintf(out, "%s0x%02x,", i % 16 ? " " : "\n    ", image[i]);
+    fprintf(out, "%s\n};\n\n", size > 0 ? "" : "0");
+
+    // Bytes covered by translated code
+    fprintf(out, "static unsigned char CODE[0x10000];\n\n");
+
+    fputs(fallbackSource, out);
+    fputs(dumpSource, out);
+
+    fprintf(out, "int main(void) {\n");
+    fprintf(out, "    unsigned short R0 = 0, R1 = 0, R2 = 0, R3 = 0, AC = 0, SP = 0x%04x, BP = 0x%04x, PC = 0x%04x, IR = 0;\n",
+            sp, (unsigned short) (sp - 0x02), pc);
+    fprintf(out, "    unsigned char flags = 0;\n");
+    fprintf(out, "    memcpy(M, IMAGE, sizeof(IMAGE));\n");
+    for (int start = 0; start < MEMORY_SIZE; start++) {
+        // Mark the bytes covered by translated code, one run at a time
+        if (!code[start]) continue;
+        int end = start;
+        while (end + 1 < MEMORY_SIZE && code[end + 1]) end++;
+        fprintf(out, "    memset(CODE + 0x%04x, 1, %d);\n", start, end - start + 1);
+        start = end;
+    }
+    fprintf(out, "    goto L_%04x;\n\n", pc);
+
+    for (int address = 0; address < MEMORY_SIZE; address++) {
+        if (reachable[address]) emitInstruction(out, address);
+    }
+
+    fprintf(out, "\ndispatch:\n    switch (PC) {\n");
+    for (int address = 0; address < MEMORY_SIZE; address++) {
+        if (reachable[address]) fprintf(out, "        case 0x%04x: goto L_%04x;\n", address, address);
+    }
+    fprintf(out, "        default: break;\n    }\n");
+
+    fprintf(out, "\nfallback: {\n");
+    fprintf(out, "        unsigned short r[9] = {R0, R1, R2, R3, AC, SP, BP, PC, IR};\n");
+    fprintf(out, "        interpret(r, &flags);\n");
+    fprintf(out, "        R0 = r[0]; R1 = r[1]; R2 = r[2]; R3 = r[3]; AC = r[4]; SP = r[5]; BP = r[6]; PC = r[7]; IR = r[8];\n");
+    fprintf(out, "    }\n");
+
+    fprintf(out, "\ndone: {\n");
+    fprintf(out, "        unsigned short r[9] = {R0, R1, R2, R3, AC, SP, BP, PC, IR};\n");
+    fprintf(out, "        dumpState(r, flags, 0x%04x, 0x%04x);\n", (unsigned short) (sp - 0x02), pc);
+    fprintf(out, "    }\n    return 0;\n}\n");
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 4) {
+        fprintf(stderr, "Usage: ./ssam2c <file.bin> <stack pointer start> <program counter start> [out.c]\n");
+        return 1;
+    }
+
+    FILE *binary = fopen(argv[1], "rb");
+    if (!binary) {
+        fprintf(stderr, "Error: specified binary file \"%s\" could not be loaded.\n", argv[1]);
+        return 1;
+    }
+    imageSize = loadImage(binary, image);
+    fclose(binary);
+    if (imageSize < 0) {
+        fprintf(stderr, "Error: specified binary file \"%s\" could not be loaded.\n", argv[1]);
+        return 1;
+    }
+
+    unsigned short sp = strtol(argv[2], NULL, 16), pc = strtol(argv[3], NULL, 16);
+
+    FILE *out = argc > 4 ? fopen(argv[4], "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "Error: %s could not be opened.\n", argv[4]);
+        return 1;
+    }
+
+    findReachable(pc);
+    emitProgram(out, argv[1], sp, pc);
+    if (out != stdout) fclose(out);
+    return 0;
+}
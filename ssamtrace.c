@@ -0,0 +1,170 @@
+// Decodes a binary trace written by ./vm --trace into readable text.
+// Created by Jackson Eshbaugh on 16.10.2026.
+//
+// Usage: ./ssamtrace <trace> [<start>-<end>]
+//
+// Prints one line per instruction: its number in the trace, its address and IR, then the
+// register it wrote and the words it stored, with their new values. Given a range of
+// addresses (in hex, both ends included), only the instructions run from that range are
+// printed; the rest are still decoded, since each record builds on the ones before it.
+// Where the VM dropped records to keep up, a line says how many instructions are missing.
+
+#include "controller.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const char *registerNames[] = {"R0", "R1", "R2", "R3", "AC", "SP", "BP", "PC", "IR"};
+
+/**
+ * A trace file being read, a buffer at a time.
+ */
+typedef struct {
+    FILE *in;
+    unsigned char buffer[TRACE_BUFFER_SIZE];
+    size_t length;
+    size_t position;
+} TraceReader;
+
+/**
+ * Reads the next byte of the trace.
+ * @param reader the reader
+ * @return the byte, or EOF at the end of the file
+ */
+int nextByte(TraceReader *reader) {
+    if (reader->position == reader->length) {
+        reader->length = fread(reader->buffer, 1, TRACE_BUFFER_SIZE, reader->in);
+        reader->position = 0;
+        if (reader->length == 0) return EOF;
+    }
+    return reader->buffer[reader->position++];
+}
+
+/**
+ * Reads a big-endian word.
+ * @param reader the reader
+ * @param word set to the word
+ * @return 1 on success, 0 at the end of the file
+ */
+int readWord(TraceReader *reader, unsigned short *word) {
+    int high = nextByte(reader), low = nextByte(reader);
+    if (high == EOF || low == EOF) return 0;
+    *word = high << 8 | low;
+    return 1;
+}
+
+/**
+ * Reads a zigzag-encoded varint delta and applies it to a value.
+ * @param reader the reader
+ * @param value the value to apply the delta to
+ * @return 1 on success, 0 at the end of the file
+ */
+int readDelta(TraceReader *reader, unsigned short *value) {
+    unsigned int zigzag = 0;
+    for (int shift = 0; shift < 21; shift += 7) {
+        int byte = nextByte(reader);
+        if (byte == EOF) return 0;
+        zigzag |= (unsigned int) (byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            unsigned short delta = (zigzag >> 1) ^ -(zigzag & 1);
+            *value += delta;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: ./ssamtrace <trace> [<start>-<end>]\n");
+        return 1;
+    }
+
+    unsigned short start = 0x0000, end = 0xFFFF;
+    if (argc > 2) {
+        char *dash = strchr(argv[2], '-');
+        if (!dash) {
+            fprintf(stderr, "Error: \"%s\" isn't a range like 0400-04ff.\n", argv[2]);
+            return 1;
+        }
+        start = strtol(argv[2], NULL, 16);
+        end = strtol(dash + 1, NULL, 16);
+    }
+
+    static TraceReader reader;
+    reader.in = fopen(argv[1], "rb");
+    if (!reader.in) {
+        fprintf(stderr, "Error: trace \"%s\" could not be opened.\n", argv[1]);
+        return 1;
+    }
+
+    // The header: magic, version, and the registers as the trace began
+    char magic[4];
+    for (int i = 0; i < 4; i++) magic[i] = nextByte(&reader);
+    unsigned short registers[REG_COUNT];
+    int valid = memcmp(magic, TRACE_MAGIC, 4) == 0 && nextByte(&reader) == TRACE_VERSION;
+    for (int r = 0; valid && r < REG_COUNT; r++) valid = readWord(&reader, &registers[r]);
+    if (!valid) {
+        fprintf(stderr, "Error: \"%s\" isn't a trace.\n", argv[1]);
+        fclose(reader.in);
+        return 1;
+    }
+
+    static unsigned short irAt[MEMORY_SIZE];
+    unsigned short nextPC = registers[PC], lastAddress = 0, lastWord = 0;
+    unsigned long long count = 0;
+    int header;
+    while ((header = nextByte(&reader)) != EOF) {
+        if (header == TRACE_SYNC) {
+            // Records were dropped before this one: start again from the state given
+            unsigned long long dropped = 0;
+            int complete = 1;
+            for (int i = 0; complete && i < 8; i++) {
+                int byte = nextByte(&reader);
+                complete = byte != EOF;
+                dropped = dropped << 8 | (byte & 0xFF);
+            }
+            complete = complete && readWord(&reader, &nextPC) && readWord(&reader, &lastAddress) && readWord(&reader, &lastWord);
+            for (int r = 0; complete && r < REG_COUNT; r++) complete = readWord(&reader, &registers[r]);
+            if (!complete) {
+                fprintf(stderr, "Error: the trace is cut off or damaged after %llu instructions.\n", count);
+                fclose(reader.in);
+                return 1;
+            }
+            printf("... %llu instructions dropped\n", dropped);
+            memset(irAt, 0, sizeof(irAt));
+            count += dropped;
+            continue;
+        }
+
+        unsigned short pc = nextPC, addresses[2], words[2];
+        int reg = (header & TRACE_REGISTER) - 1, writes = header >> TRACE_WRITES_SHIFT;
+        int complete = reg < REG_COUNT && writes <= 2;
+        if (complete && (header & TRACE_JUMP)) complete = readDelta(&reader, &pc);
+        if (complete && (header & TRACE_IR)) complete = readWord(&reader, &irAt[pc]);
+        if (complete && reg >= 0) complete = readDelta(&reader, &registers[reg]);
+        for (int i = 0; complete && i < writes; i++) {
+            complete = readDelta(&reader, &lastAddress) && readDelta(&reader, &lastWord);
+            addresses[i] = lastAddress;
+            words[i] = lastWord;
+        }
+        if (!complete) {
+            fprintf(stderr, "Error: the trace is cut off or damaged after %llu instructions.\n", count);
+            fclose(reader.in);
+            return 1;
+        }
+
+        if (pc >= start && pc <= end) {
+            printf("%llu 0x%04hx: 0x%04hx", count, pc, irAt[pc]);
+            if (reg >= 0) printf("  %s=0x%04hx", registerNames[reg], registers[reg]);
+            for (int i = 0; i < writes; i++) printf("  [0x%04hx]=0x%04hx", addresses[i], words[i]);
+            printf("\n");
+        }
+        nextPC = pc + 0x02;
+        count++;
+    }
+
+    fclose(reader.in);
+    return 0;
+}
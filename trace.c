@@ -0,0 +1,198 @@
+// Records every instruction a VM runs to a compact binary trace file.
+// Created by Jackson Eshbaugh on 16.10.2026.
+
+#include "trace.h"
+#include "controller.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Appends a big-endian word to a record.
+ * @param cursor where to write it
+ * @param word the word
+ * @return the byte after it
+ */
+unsigned char *traceWord(unsigned char *cursor, unsigned short word) {
+    *cursor++ = word >> 8;
+    *cursor++ = word & 0xFF;
+    return cursor;
+}
+
+int enableTrace(SsamVm *vm, const char *path, WriterPolicy policy) {
+    destroyTrace(vm);
+
+    TraceLog *trace = calloc(1, sizeof(TraceLog));
+    if (!trace) return 0;
+    FILE *out = fopen(path, "wb");
+    if (!out) {
+        free(trace);
+        return 0;
+    }
+    trace->writer = openWriter(out, policy);
+    if (!trace->writer) {
+        fclose(out);
+        free(trace);
+        return 0;
+    }
+
+    unsigned char *cursor = trace->buffer;
+    for (int i = 0; i < 4; i++) *cursor++ = TRACE_MAGIC[i];
+    *cursor++ = TRACE_VERSION;
+    for (int r = 0; r < REG_COUNT; r++) {
+        trace->registers[r] = vm->R[r];
+        cursor = traceWord(cursor, vm->R[r]);
+    }
+    trace->length = cursor - trace->buffer;
+    trace->nextPC = vm->R[PC];
+    vm->trace = trace;
+    return 1;
+}
+
+void traceFetch(SsamVm *vm, const DecodedInstruction *d) {
+    TraceLog *trace = vm->trace;
+    trace->pending = 1;
+    trace->pc = d->tag;
+    trace->ir = d->word;
+
+    switch (d->op) {
+        case OP_LODI:
+        case OP_LODA:
+        case OP_LODR:
+        case OP_LODRD:
+        case OP_MOV:
+            trace->reg = d->regA;
+            break;
+        case OP_NEG:
+        case OP_ADDR:
+        case OP_ADDI:
+        case OP_SUBR:
+        case OP_SUBI:
+            trace->reg = AC;
+            break;
+        default:
+            trace->reg = REG_COUNT;
+            break;
+    }
+
+    MemoryAccess accesses[2];
+    int count = dataAccesses(vm, d, accesses);
+    trace->writes = 0;
+    for (int i = 0; i < count; i++) {
+        if (accesses[i].write) trace->address[trace->writes++] = accesses[i].address;
+    }
+}
+
+/**
+ * Hands the buffered records to the writer thread. If it drops them, the encoder forgets
+ * the IRs it has seen, and the next record is preceded by a sync record.
+ * @param trace the trace
+ */
+void queueTrace(TraceLog *trace) {
+    if (trace->length > 0 && !putWriter(trace->writer, trace->buffer, trace->length)) {
+        // A sync record dropped with them has to be sent again, for its count as well
+        trace->dropped += trace->bufferRecords;
+        trace->unsynced += trace->bufferRecords + trace->bufferSynced;
+        memset(trace->irAt, 0, sizeof(trace->irAt));
+    }
+    trace->length = 0;
+    trace->bufferRecords = 0;
+    trace->bufferSynced = 0;
+}
+
+/**
+ * Appends a sync record (see trace.h), so the records after a drop can be decoded.
+ * @param trace the trace
+ * @param cursor where to write it
+ * @return the byte after it
+ */
+unsigned char *traceSync(TraceLog *trace, unsigned char *cursor) {
+    *cursor++ = TRACE_SYNC;
+    for (int shift = 56; shift >= 0; shift -= 8) *cursor++ = trace->unsynced >> shift;
+    cursor = traceWord(cursor, trace->nextPC);
+    cursor = traceWord(cursor, trace->lastAddress);
+    cursor = traceWord(cursor, trace->lastWord);
+    for (int r = 0; r < REG_COUNT; r++) cursor = traceWord(cursor, trace->registers[r]);
+    trace->bufferSynced += trace->unsynced;
+    trace->unsynced = 0;
+    return cursor;
+}
+
+/**
+ * Appends a 16-bit delta to a record, zigzag-encoded as a varint.
+ * @param cursor where to write it
+ * @param delta the delta
+ * @return the byte after it
+ */
+unsigned char *traceDelta(unsigned char *cursor, unsigned short delta) {
+    unsigned short zigzag = (unsigned short) (delta << 1) ^ (delta & 0x8000 ? 0xFFFF : 0);
+    while (zigzag >= 0x80) {
+        *cursor++ = (zigzag & 0x7F) | 0x80;
+        zigzag >>= 7;
+    }
+    *cursor++ = zigzag;
+    return cursor;
+}
+
+void traceExecute(SsamVm *vm) {
+    TraceLog *trace = vm->trace;
+    if (!trace->pending) return; // IR was loaded some other way than fetch()
+    trace->pending = 0;
+
+    if (trace->length > TRACE_BUFFER_SIZE - TRACE_RECORD_MAX - TRACE_SYNC_SIZE) queueTrace(trace);
+    unsigned char *header = trace->buffer + trace->length;
+    if (trace->unsynced) header = traceSync(trace, header);
+    unsigned char *cursor = header + 1;
+
+    *header = trace->reg == REG_COUNT ? 0 : trace->reg + 1;
+    if (trace->pc != trace->nextPC) {
+        *header |= TRACE_JUMP;
+        cursor = traceDelta(cursor, trace->pc - trace->nextPC);
+    }
+    if (trace->ir != trace->irAt[trace->pc]) {
+        *header |= TRACE_IR;
+        cursor = traceWord(cursor, trace->ir);
+        trace->irAt[trace->pc] = trace->ir;
+    }
+    if (trace->reg != REG_COUNT) {
+        cursor = traceDelta(cursor, vm->R[trace->reg] - trace->registers[trace->reg]);
+        trace->registers[trace->reg] = vm->R[trace->reg];
+    }
+
+    // Read the words straight from memory, so device ports aren't read again
+    *header |= trace->writes << TRACE_WRITES_SHIFT;
+    for (int i = 0; i < trace->writes; i++) {
+        unsigned short address = trace->address[i];
+        unsigned short word = vm->memory[address] << 8 | vm->memory[(unsigned short) (address + 1)];
+        cursor = traceDelta(cursor, address - trace->lastAddress);
+        cursor = traceDelta(cursor, word - trace->lastWord);
+        trace->lastAddress = address;
+        trace->lastWord = word;
+    }
+
+    trace->length = cursor - trace->buffer;
+    trace->nextPC = trace->pc + 0x02;
+    trace->records++;
+    trace->bufferRecords++;
+}
+
+int flushTrace(SsamVm *vm) {
+    TraceLog *trace = vm->trace;
+    if (!trace) return 1;
+    queueTrace(trace);
+    return syncWriter(trace->writer);
+}
+
+void destroyTrace(SsamVm *vm) {
+    TraceLog *trace = vm->trace;
+    if (!trace) return;
+    queueTrace(trace);
+    if (trace->unsynced) {
+        // Count the records dropped at the end too, waiting for room this time
+        trace->writer->policy = WRITER_BLOCK;
+        trace->length = traceSync(trace, trace->buffer) - trace->buffer;
+        queueTrace(trace);
+    }
+    closeWriter(trace->writer);
+    free(trace);
+    vm->trace = NULL;
+}
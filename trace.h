@@ -0,0 +1,113 @@
+// Records every instruction a VM runs to a compact binary trace file.
+// Created by Jackson Eshbaugh on 16.10.2026.
+//
+// A trace file starts with the magic bytes "SSTR", a version byte (1), and the registers
+// R0 through IR as the trace began, one big-endian word each. A record follows for each
+// instruction, encoded against what came before it:
+// - a header byte: the low four bits are the register the instruction wrote plus one (0
+//   for none), TRACE_JUMP is set if it didn't run from the address after the previous
+//   one, TRACE_IR is set if its IR differs from the last one run at that address, and the
+//   top two bits give the number of words it stored (0 to 2)
+// - with TRACE_JUMP, its address, as a delta from the address after the previous one
+// - with TRACE_IR, its IR, as a big-endian word
+// - with a register, the register's new value, as a delta from the last value recorded
+//   for that register (or its value in the header)
+// - for each word stored, its address, as a delta from the last address stored to, and
+//   the word, as a delta from the last word stored
+// Deltas are 16-bit, zigzag-encoded so small negative ones stay small, and written as
+// varints: seven bits a byte, low bits first, with the top bit set on all but the last.
+// A straight-line instruction that runs again, writing a register, usually takes 2 bytes.
+//
+// The file is written by a writer thread (see writer.h). If it is told to drop output when
+// it falls behind, the records after a drop start with a sync record, whose header byte
+// is TRACE_SYNC: the number of instructions dropped (a big-endian 64-bit count), then the
+// address after the last instruction kept, the last address and word stored, and the
+// registers, one big-endian word each. The last IR seen at each address is forgotten. A
+// trace whose last records were dropped ends with a sync record too.
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "vm.h"
+#include "writer.h"
+
+#define TRACE_MAGIC "SSTR"
+#define TRACE_VERSION 1
+#define TRACE_HEADER_SIZE (5 + 2 * REG_COUNT)
+#define TRACE_BUFFER_SIZE 65536
+#define TRACE_RECORD_MAX 21 // header, jump, IR, register, and two stores
+#define TRACE_SYNC_SIZE (9 + 2 * (3 + REG_COUNT))
+
+// Header byte of a record
+#define TRACE_REGISTER 0x0F // the register written, plus one
+#define TRACE_JUMP 0x10
+#define TRACE_IR 0x20
+#define TRACE_WRITES_SHIFT 6
+#define TRACE_SYNC 0xC0 // three stores, which no instruction does
+
+/**
+ * A trace being written, and what its records are encoded against.
+ */
+typedef struct TraceLog {
+    AsyncWriter *writer;
+    unsigned char buffer[TRACE_BUFFER_SIZE]; // records not yet handed to the writer
+    size_t length;
+    unsigned long long records;
+    unsigned long long bufferRecords; // records in buffer
+    unsigned long long dropped; // records the writer dropped
+    unsigned long long unsynced; // records dropped that no sync record has counted yet
+    unsigned long long bufferSynced; // drops counted by sync records in buffer
+
+    unsigned short nextPC; // the address after the last instruction recorded
+    unsigned short registers[REG_COUNT]; // the last value recorded for each register
+    unsigned short lastAddress, lastWord; // the last word stored
+    unsigned short irAt[MEMORY_SIZE]; // the last IR recorded at each address
+
+    // The instruction being run, between fetch() and the end of execute()
+    int pending;
+    unsigned short pc, ir;
+    unsigned char reg; // REG_COUNT if none
+    unsigned char writes;
+    unsigned short address[2];
+} TraceLog;
+
+/**
+ * Starts tracing a VM to a file, replacing any trace already running. The file starts
+ * with the VM's registers as they are now.
+ * @param vm the VM
+ * @param path the file to write the trace to
+ * @param policy what to do when the writer thread falls behind
+ * @return 1 on success, 0 if the file couldn't be opened, or the trace allocated or its
+ *         writer started
+ */
+int enableTrace(SsamVm *vm, const char *path, WriterPolicy policy);
+
+/**
+ * Notes the instruction about to run: where it is, and which register and words it is
+ * about to write. Called by fetch() before it moves PC.
+ * @param vm the VM
+ * @param d the instruction
+ */
+void traceFetch(SsamVm *vm, const DecodedInstruction *d);
+
+/**
+ * Adds the record for the instruction noted by traceFetch(), now that it has run. Called
+ * at the end of execute().
+ * @param vm the VM
+ */
+void traceExecute(SsamVm *vm);
+
+/**
+ * Writes out the records buffered so far, and waits for them to reach the file.
+ * @param vm the VM
+ * @return 1 if every record has been written (or dropped), 0 if a write failed
+ */
+int flushTrace(SsamVm *vm);
+
+/**
+ * Flushes and closes a VM's trace, if it has one.
+ * @param vm the VM
+ */
+void destroyTrace(SsamVm *vm);
+
+#endif //TRACE_H
@@ -0,0 +1,194 @@
+// Records a VM's execution so it can be run backwards, one instruction at a time.
+// Created by Jackson Eshbaugh on 16.10.2026.
+
+#include "undo.h"
+#include "controller.h"
+#include "memory.h"
+#include "snapshot.h"
+#include <stdlib.h>
+#include <string.h>
+
+int enableUndo(SsamVm *vm, int entries) {
+    if (entries < 1) return 0;
+    if (vm->undo) destroyUndo(vm);
+
+    UndoLog *log = calloc(1, sizeof(UndoLog));
+    if (!log) return 0;
+    log->entries = malloc((size_t) entries * sizeof(UndoEntry));
+    if (!log->entries) {
+        free(log);
+        return 0;
+    }
+    log->capacity = entries;
+    vm->undo = log;
+    return 1;
+}
+
+/**
+ * Frees the checkpoints taken after the current step, which no longer lie in the past.
+ * @param vm the VM
+ * @param log the VM's undo log
+ */
+void dropLaterCheckpoints(SsamVm *vm, UndoLog *log) {
+    while (log->checkpointCount > 0 && log->checkpointSteps[log->checkpointCount - 1] > log->step) {
+        destroySnapshot(vm, log->checkpoints[--log->checkpointCount]);
+    }
+}
+
+/**
+ * Snapshots the VM as of the current step, dropping the oldest checkpoint if all are in use.
+ * @param vm the VM
+ * @param log the VM's undo log
+ */
+void takeUndoCheckpoint(SsamVm *vm, UndoLog *log) {
+    // Re-running from a checkpoint passes back through the step it was taken at
+    if (log->checkpointCount > 0 && log->checkpointSteps[log->checkpointCount - 1] == log->step) return;
+
+    VmSnapshot *snapshot = takeSnapshot(vm);
+    if (!snapshot) return; // stepping back just won't reach as far
+
+    if (log->checkpointCount == UNDO_CHECKPOINTS) {
+        destroySnapshot(vm, log->checkpoints[0]);
+        memmove(log->checkpoints, log->checkpoints + 1, (UNDO_CHECKPOINTS - 1) * sizeof(VmSnapshot *));
+        memmove(log->checkpointSteps, log->checkpointSteps + 1, (UNDO_CHECKPOINTS - 1) * sizeof(unsigned long long));
+        log->checkpointCount--;
+    }
+    log->checkpoints[log->checkpointCount] = snapshot;
+    log->checkpointSteps[log->checkpointCount++] = log->step;
+}
+
+/**
+ * Restores one of the checkpoints, forgetting everything recorded after it.
+ * @param vm the VM
+ * @param log the VM's undo log
+ * @param index which checkpoint to restore
+ */
+void restoreUndoCheckpoint(SsamVm *vm, UndoLog *log, int index) {
+    restoreSnapshot(vm, log->checkpoints[index]);
+    vm->cycles -= log->step - log->checkpointSteps[index];
+    log->step = log->checkpointSteps[index];
+    log->count = 0;
+    dropLaterCheckpoints(vm, log);
+}
+
+/**
+ * Saves the word at address into the entry, before an instruction stores to it.
+ * @param vm the VM
+ * @param entry the entry for the instruction
+ * @param address the address about to be stored to
+ */
+void saveWord(SsamVm *vm, UndoEntry *entry, unsigned short address) {
+    entry->address[entry->writes] = address;
+    entry->word[entry->writes++] = getWord(vm, address);
+}
+
+void undoRecord(SsamVm *vm, const DecodedInstruction *d) {
+    UndoLog *log = vm->undo;
+    if (log->step % log->capacity == 0) takeUndoCheckpoint(vm, log);
+
+    UndoEntry *entry = &log->entries[log->next];
+    entry->pc = vm->R[PC];
+    entry->ir = vm->R[IR];
+    entry->sp = vm->R[SP];
+    entry->bp = vm->R[BP];
+    entry->flags = vm->flags;
+    entry->reg = REG_COUNT;
+    entry->writes = 0;
+
+    switch (d->op) {
+        case OP_LODI:
+        case OP_LODA:
+        case OP_LODR:
+        case OP_LODRD:
+        case OP_MOV:
+            entry->reg = d->regA;
+            break;
+        case OP_NEG:
+        case OP_ADDR:
+        case OP_ADDI:
+        case OP_SUBR:
+        case OP_SUBI:
+            entry->reg = AC;
+            break;
+        default:
+            break;
+    }
+    if (entry->reg != REG_COUNT) entry->value = vm->R[entry->reg];
+
+    MemoryAccess accesses[2];
+    int count = dataAccesses(vm, d, accesses);
+    for (int i = 0; i < count; i++) {
+        // What a device did with a store can't be taken back, so only RAM is saved
+        unsigned short address = accesses[i].address;
+        if (accesses[i].write && !(vm->pageFlags[address >> PAGE_SHIFT] & PAGE_DEVICE)) saveWord(vm, entry, address);
+    }
+
+    log->next = (log->next + 1) % log->capacity;
+    if (log->count < log->capacity) log->count++;
+    log->step++;
+}
+
+int reverseStep(SsamVm *vm) {
+    UndoLog *log = vm->undo;
+    if (log->count > 0) {
+        log->next = (log->next + log->capacity - 1) % log->capacity;
+        log->count--;
+        const UndoEntry *entry = &log->entries[log->next];
+
+        // Stores are undone newest first, in case they overlapped
+        for (int i = entry->writes - 1; i >= 0; i--) setWord(vm, entry->address[i], entry->word[i]);
+        if (entry->reg != REG_COUNT) vm->R[entry->reg] = entry->value;
+        vm->R[SP] = entry->sp;
+        vm->R[BP] = entry->bp;
+        vm->R[PC] = entry->pc;
+        vm->R[IR] = entry->ir;
+        vm->flags = entry->flags;
+        vm->current = 0;
+        vm->cycles--;
+
+        log->step--;
+        dropLaterCheckpoints(vm, log);
+        return 1;
+    }
+
+    // The ring is used up: restore the newest checkpoint before the target, then re-run
+    // from there (recording again as it goes).
+    if (log->step == 0) return 0;
+    unsigned long long target = log->step - 1;
+    int index = log->checkpointCount - 1;
+    while (index >= 0 && log->checkpointSteps[index] > target) index--;
+    if (index < 0) return 0;
+
+    restoreUndoCheckpoint(vm, log, index);
+    while (log->step < target && !haltReached(vm)) runUntil(vm, target - log->step);
+    return 1;
+}
+
+unsigned long long reverseContinue(SsamVm *vm) {
+    UndoLog *log = vm->undo;
+    unsigned long long start = log->step;
+
+    // Jump straight to the oldest checkpoint if it is older than anything in the ring
+    if (log->checkpointCount > 0 && log->checkpointSteps[0] < log->step - log->count) {
+        restoreUndoCheckpoint(vm, log, 0);
+    } else {
+        while (log->count > 0) reverseStep(vm);
+    }
+    return start - log->step;
+}
+
+void clearUndo(SsamVm *vm) {
+    UndoLog *log = vm->undo;
+    while (log->checkpointCount > 0) destroySnapshot(vm, log->checkpoints[--log->checkpointCount]);
+    log->count = 0;
+    log->next = 0;
+    log->step = 0;
+}
+
+void destroyUndo(SsamVm *vm) {
+    if (!vm->undo) return;
+    clearUndo(vm);
+    free(vm->undo->entries);
+    free(vm->undo);
+    vm->undo = NULL;
+}
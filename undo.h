@@ -0,0 +1,91 @@
+// Records a VM's execution so it can be run backwards, one instruction at a time.
+// Created by Jackson Eshbaugh on 16.10.2026.
+//
+// While recording, every instruction adds an entry to a fixed-size ring holding only what
+// the instruction is about to overwrite: PC, IR, SP, BP and the flags, the one other
+// register it writes (if any), and the old contents of the words it stores to (at most
+// two, for call). Every time as many instructions have run as the ring holds, a full
+// snapshot of the VM is also taken, keeping the newest UNDO_CHECKPOINTS of them. Stepping
+// back pops entries off the ring; once the ring is empty, the nearest earlier snapshot is
+// restored and the program re-run up to the instruction before.
+
+#ifndef UNDO_H
+#define UNDO_H
+
+#include "vm.h"
+
+#define UNDO_CHECKPOINTS 4
+#define UNDO_DEFAULT_ENTRIES 65536
+
+/**
+ * What one instruction overwrote.
+ */
+typedef struct {
+    unsigned short pc, ir, sp, bp; // before the instruction ran
+    unsigned short value; // the old value of reg
+    unsigned short address[2]; // the words stored to, in the order they were stored
+    unsigned short word[2]; // what those words held before
+    unsigned char reg; // the other register written, or REG_COUNT if none
+    unsigned char writes; // the number of words stored to
+    char flags;
+} UndoEntry;
+
+/**
+ * The undo history of a VM being recorded.
+ */
+typedef struct UndoLog {
+    UndoEntry *entries; // ring of the newest entries
+    int capacity;
+    int count;
+    int next; // where the next entry goes
+    unsigned long long step; // instructions run since recording began, less those undone
+    VmSnapshot *checkpoints[UNDO_CHECKPOINTS]; // oldest first
+    unsigned long long checkpointSteps[UNDO_CHECKPOINTS];
+    int checkpointCount;
+} UndoLog;
+
+/**
+ * Starts recording a VM. Runs from then on go one instruction at a time (the JIT and
+ * superinstructions aren't used while recording).
+ * @param vm the VM
+ * @param entries the size of the ring: how many instructions can be undone before a
+ *                snapshot has to be restored and re-run
+ * @return 1 on success, 0 if the log could not be allocated
+ */
+int enableUndo(SsamVm *vm, int entries);
+
+/**
+ * Records the instruction about to run. Called before fetch(), while the VM still holds
+ * the state the instruction starts from.
+ * @param vm the VM
+ * @param d the instruction at PC
+ */
+void undoRecord(SsamVm *vm, const DecodedInstruction *d);
+
+/**
+ * Puts the VM back in the state it was in before the last instruction ran.
+ * @param vm the VM
+ * @return 1 if an instruction was undone, 0 if there is no recorded history left
+ */
+int reverseStep(SsamVm *vm);
+
+/**
+ * Puts the VM back in the oldest state still recorded.
+ * @param vm the VM
+ * @return the number of instructions undone
+ */
+unsigned long long reverseContinue(SsamVm *vm);
+
+/**
+ * Forgets all recorded history, e.g. when the VM is reset. Recording carries on.
+ * @param vm the VM
+ */
+void clearUndo(SsamVm *vm);
+
+/**
+ * Stops recording and frees the log.
+ * @param vm the VM
+ */
+void destroyUndo(SsamVm *vm);
+
+#endif //UNDO_H
@@ -0,0 +1,64 @@
+// The state of one virtual machine: registers, flags, memory and execution caches.
+// Created by Jackson Eshbaugh on 16.10.2026.
+
+#include "vm.h"
+
+#include "controller.h"
+#include "memory.h"
+#include "profile.h"
+#include "undo.h"
+#include "watch.h"
+#include "device.h"
+#include "trace.h"
+#include "breakpoint.h"
+#include "loop.h"
+#ifdef SSAM_JIT
+#include "jit.h"
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+SsamVm *createVm() {
+    // The VM and its memory share one anonymous mapping. The host only backs the pages
+    // that get written, so an idle VM costs a few pages rather than all of its memory and
+    // caches.
+    unsigned char *region = mmap(NULL, MEMORY_SIZE + sizeof(SsamVm), PROT_READ | PROT_WRITE,
+                                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED) return NULL;
+    SsamVm *vm = (SsamVm *) (region + MEMORY_SIZE);
+    vm->memory = region;
+    resetVm(vm);
+    return vm;
+}
+
+void destroyVm(SsamVm *vm) {
+    if (!vm) return;
+#ifdef SSAM_JIT
+    jitDestroy(vm);
+#endif
+    free(vm->profile);
+    destroyUndo(vm);
+    clearWatchpoints(vm);
+    destroyDevices(vm);
+    destroyTrace(vm);
+    clearBreakpoints(vm);
+    destroyLoopDetection(vm);
+    munmap(vm->memory, MEMORY_SIZE + sizeof(SsamVm));
+}
+
+void resetVm(SsamVm *vm) {
+    if (vm->undo) clearUndo(vm);
+    memset(vm->R, 0, sizeof(vm->R));
+    vm->flags = 0x0;
+    vm->stopped = 0;
+    vm->cycles = 0;
+    memset(vm->pageFlags, 0, sizeof(vm->pageFlags));
+    markDevicePages(vm);
+    if (vm->devices) vm->devices->exited = 0;
+    vm->dirtyCount = 0;
+    vm->tracked = NULL;
+    clearMemory(vm);
+    if (vm->profile) memset(vm->profile, 0, sizeof(Profile));
+    resetDecoded(vm);
+}
@@ -0,0 +1,93 @@
+// The state of one virtual machine: registers, flags, memory and execution caches.
+// Created by Jackson Eshbaugh on 16.10.2026.
+
+#ifndef VM_H
+#define VM_H
+
+#include "decode.h"
+
+#define REG_COUNT 9
+#define MEMORY_SIZE 0x10000
+#define PAGE_SHIFT 8
+#define PAGE_COUNT (MEMORY_SIZE >> PAGE_SHIFT)
+#define PAGE_BYTES (1 << PAGE_SHIFT)
+#define DECODE_CACHE_SIZE 2048 // one entry per word of a 4 KiB window of code
+#define DECODE_CACHE_MASK (DECODE_CACHE_SIZE - 1)
+
+typedef struct JitState JitState;
+typedef struct Profile Profile;
+typedef struct VmSnapshot VmSnapshot;
+typedef struct UndoLog UndoLog;
+typedef struct WatchList WatchList;
+typedef struct DeviceBus DeviceBus;
+typedef struct TraceLog TraceLog;
+typedef struct BreakList BreakList;
+typedef struct LoopDetector LoopDetector;
+
+// Why the last run started by runLimited() (see controller.h) stopped short of a halt
+#define STOP_BUDGET 1 // its instruction budget ran out
+#define STOP_TIMEOUT 2 // its deadline passed
+#define STOP_LOOP 3 // it was found in a loop it can never leave (see loop.h)
+
+// Flags kept for each page of memory. Writes to a page with no flags set need no extra work.
+#define PAGE_CODE 0x1 // holds at least one decoded instruction
+#define PAGE_CLEAN 0x2 // unwritten since the tracked snapshot was taken
+#define PAGE_DEVICE 0x4 // holds a device (see device.h)
+#define PAGE_HASHED 0x8 // unwritten since the loop detector last hashed it (see loop.h)
+
+/**
+ * A virtual machine. Every function in controller.h and memory.h works on one of these,
+ * so any number of them can live in one process.
+ */
+typedef struct SsamVm {
+    unsigned short R[REG_COUNT];
+    char flags; // 0th bit is the haltReached flag; 1st is the error flag.
+    unsigned char stopped; // STOP_* if a limit or loop stopped the last limited run, otherwise 0
+    unsigned long long cycles; // instructions run, not counting the run in progress
+    const unsigned long *runSteps; // instructions the run in progress has done, if any
+
+    // Direct-mapped cache of decoded instructions, indexed by word address.
+    DecodedInstruction decodeCache[DECODE_CACHE_SIZE];
+    // The instruction most recently fetched.
+    DecodedInstruction *current;
+    // Decoded form of an IR that wasn't loaded by fetch().
+    DecodedInstruction scratch;
+
+    // PAGE_* flags for each 256-byte page.
+    unsigned char pageFlags[PAGE_COUNT];
+    // The pages written since the tracked snapshot was taken (see snapshot.h).
+    unsigned short dirtyPages[PAGE_COUNT];
+    int dirtyCount;
+    const VmSnapshot *tracked;
+    // MEMORY_SIZE bytes, mapped just before the VM itself (see createVm()).
+    unsigned char *memory;
+
+    JitState *jit; // translated code; created the first time the JIT runs
+    Profile *profile; // execution counts; NULL unless profiling is on (see profile.h)
+    UndoLog *undo; // history for reverse execution; NULL unless recording (see undo.h)
+    WatchList *watch; // watched address ranges; NULL unless any are set (see watch.h)
+    DeviceBus *devices; // memory-mapped devices; NULL unless any are mapped (see device.h)
+    TraceLog *trace; // the binary trace being written; NULL unless tracing (see trace.h)
+    BreakList *breaks; // breakpoints; NULL unless any are set (see breakpoint.h)
+    LoopDetector *loops; // NULL unless loop detection is on (see loop.h)
+} SsamVm;
+
+/**
+ * Creates a VM with all registers and memory zeroed.
+ * @return the new VM, or NULL if it could not be allocated
+ */
+SsamVm *createVm();
+
+/**
+ * Destroys a VM, freeing everything it owns.
+ * @param vm the VM to destroy
+ */
+void destroyVm(SsamVm *vm);
+
+/**
+ * Resets a VM to the state createVm() returns it in, so it can run another program.
+ * @param vm the VM to reset
+ */
+void resetVm(SsamVm *vm);
+
+#endif //VM_H
@@ -0,0 +1,51 @@
+// Watchpoints: pause a run when the guest loads or stores a word in a watched range.
+// Created by Jackson Eshbaugh on 16.10.2026.
+
+#include "watch.h"
+#include "controller.h"
+#include <stdlib.h>
+
+int addWatchpoint(SsamVm *vm, unsigned short start, unsigned short end, unsigned char mode) {
+    if (!vm->watch) vm->watch = calloc(1, sizeof(WatchList));
+    WatchList *watch = vm->watch;
+    if (!watch || watch->count == WATCH_MAX) return 0;
+
+    watch->points[watch->count++] = (Watchpoint) {start, end, mode};
+    for (int page = start >> PAGE_SHIFT; page <= end >> PAGE_SHIFT; page++) watch->pages[page] |= mode;
+    return 1;
+}
+
+void clearWatchpoints(SsamVm *vm) {
+    free(vm->watch);
+    vm->watch = NULL;
+}
+
+int watchCheck(SsamVm *vm, const DecodedInstruction *d) {
+    WatchList *watch = vm->watch;
+    watch->hit = 0;
+
+    MemoryAccess accesses[2];
+    int count = dataAccesses(vm, d, accesses);
+    for (int i = 0; i < count; i++) {
+        // A word access touches address and address + 1
+        unsigned short first = accesses[i].address;
+        unsigned short last = first + 1;
+        unsigned char mode = accesses[i].write ? WATCH_WRITE : WATCH_READ;
+        if (!((watch->pages[first >> PAGE_SHIFT] | watch->pages[last >> PAGE_SHIFT]) & mode)) continue;
+
+        for (int j = 0; j < watch->count; j++) {
+            const Watchpoint *point = &watch->points[j];
+            if (!(point->mode & mode)) continue;
+            if ((first >= point->start && first <= point->end) || (last >= point->start && last <= point->end)) {
+                watch->hit = 1;
+                watch->hitIndex = j;
+                watch->hitPC = vm->R[PC];
+                watch->hitIR = d->word;
+                watch->hitAddress = first;
+                watch->hitWrite = accesses[i].write;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
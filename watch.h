@@ -0,0 +1,65 @@
+// Watchpoints: pause a run when the guest loads or stores a word in a watched range.
+// Created by Jackson Eshbaugh on 16.10.2026.
+
+#ifndef WATCH_H
+#define WATCH_H
+
+#include "vm.h"
+
+#define WATCH_MAX 16
+#define WATCH_READ 0x1
+#define WATCH_WRITE 0x2
+
+/**
+ * A watched range of addresses, start through end inclusive.
+ */
+typedef struct {
+    unsigned short start, end;
+    unsigned char mode; // WATCH_READ, WATCH_WRITE or both
+} Watchpoint;
+
+/**
+ * A VM's watchpoints, and the access that most recently hit one.
+ */
+typedef struct WatchList {
+    Watchpoint points[WATCH_MAX];
+    int count;
+    // For each page, the modes of the watchpoints touching it, so most accesses are
+    // ruled out without looking at the list.
+    unsigned char pages[PAGE_COUNT];
+
+    int hit; // 1 if the instruction last checked touched a watched word
+    int hitIndex; // which watchpoint it hit
+    unsigned short hitPC, hitIR, hitAddress; // where the instruction was, its word, and the word it touched
+    unsigned char hitWrite;
+} WatchList;
+
+/**
+ * Adds a watchpoint. While a VM has any, runs go one instruction at a time (the JIT and
+ * superinstructions aren't used) and stop with RUN_WATCH after an instruction touches one.
+ * @param vm the VM
+ * @param start the first address to watch
+ * @param end the last address to watch
+ * @param mode WATCH_READ, WATCH_WRITE or both
+ * @return 1 on success, 0 if there are already WATCH_MAX watchpoints or the list could
+ *         not be allocated
+ */
+int addWatchpoint(SsamVm *vm, unsigned short start, unsigned short end, unsigned char mode);
+
+/**
+ * Removes every watchpoint, so runs go back to full speed.
+ * @param vm the VM
+ */
+void clearWatchpoints(SsamVm *vm);
+
+/**
+ * Checks whether the instruction about to run touches a watched word, and records the
+ * access if it does. Called before fetch(), while the VM still holds the state the
+ * instruction starts from.
+ * @param vm the VM
+ * @param d the instruction at PC
+ * @return 1 if a watchpoint was hit, 0 otherwise
+ */
+int watchCheck(SsamVm *vm, const DecodedInstruction *d);
+
+#endif //WATCH_H
@@ -0,0 +1,110 @@
+// Writes output on a thread of its own, so the thread producing it never waits on I/O.
+// Created by Jackson Eshbaugh on 16.10.2026.
+
+#include "writer.h"
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * The body of the writer thread: writes out whatever is in the ring, as one or two
+ * writes (when it wraps around), and sleeps when there is nothing to write.
+ * @param arg the writer
+ * @return NULL
+ */
+void *writerThread(void *arg) {
+    AsyncWriter *writer = arg;
+    size_t tail = atomic_load_explicit(&writer->tail, memory_order_relaxed);
+
+    while (1) {
+        size_t head = atomic_load_explicit(&writer->head, memory_order_acquire);
+        if (head == tail) {
+            // Nothing to write: flush, then finish or wait for more
+            if (atomic_load_explicit(&writer->flushed, memory_order_relaxed) != tail) {
+                if (fflush(writer->out) != 0) atomic_store(&writer->failed, 1);
+                atomic_store_explicit(&writer->flushed, tail, memory_order_release);
+            }
+            if (atomic_load_explicit(&writer->closing, memory_order_acquire)) {
+                // The producer stopped putting before it set closing, so head is final
+                if (atomic_load_explicit(&writer->head, memory_order_acquire) == tail) break;
+                continue;
+            }
+            struct timespec idle = {0, WRITER_IDLE_NS};
+            nanosleep(&idle, NULL);
+            continue;
+        }
+
+        size_t start = tail & (WRITER_RING_SIZE - 1);
+        size_t length = head - tail;
+        if (start + length > WRITER_RING_SIZE) length = WRITER_RING_SIZE - start;
+        if (fwrite(writer->ring + start, 1, length, writer->out) != length) atomic_store(&writer->failed, 1);
+        tail += length;
+        atomic_store_explicit(&writer->tail, tail, memory_order_release);
+    }
+    return NULL;
+}
+
+AsyncWriter *openWriter(FILE *out, WriterPolicy policy) {
+    AsyncWriter *writer = calloc(1, sizeof(AsyncWriter));
+    if (!writer) return NULL;
+    writer->ring = malloc(WRITER_RING_SIZE);
+    if (!writer->ring) {
+        free(writer);
+        return NULL;
+    }
+    writer->out = out;
+    writer->policy = policy;
+    atomic_init(&writer->head, 0);
+    atomic_init(&writer->tail, 0);
+    atomic_init(&writer->flushed, 0);
+    atomic_init(&writer->closing, 0);
+    atomic_init(&writer->failed, 0);
+
+    if (pthread_create(&writer->thread, NULL, writerThread, writer)) {
+        free(writer->ring);
+        free(writer);
+        return NULL;
+    }
+    return writer;
+}
+
+int putWriter(AsyncWriter *writer, const void *data, size_t length) {
+    if (length > WRITER_RING_SIZE) length = WRITER_RING_SIZE; // can never fit
+    size_t head = atomic_load_explicit(&writer->head, memory_order_relaxed);
+
+    // Wait for room, or give up, depending on the policy
+    while (head + length - atomic_load_explicit(&writer->tail, memory_order_acquire) > WRITER_RING_SIZE) {
+        if (writer->policy == WRITER_DROP) {
+            writer->dropped += length;
+            return 0;
+        }
+        sched_yield();
+    }
+
+    size_t start = head & (WRITER_RING_SIZE - 1);
+    size_t first = length < WRITER_RING_SIZE - start ? length : WRITER_RING_SIZE - start;
+    memcpy(writer->ring + start, data, first);
+    memcpy(writer->ring, (const unsigned char *) data + first, length - first);
+    atomic_store_explicit(&writer->head, head + length, memory_order_release);
+    return 1;
+}
+
+int syncWriter(AsyncWriter *writer) {
+    size_t head = atomic_load_explicit(&writer->head, memory_order_relaxed);
+    while (atomic_load_explicit(&writer->flushed, memory_order_acquire) != head) {
+        if (atomic_load(&writer->failed)) break;
+        sched_yield();
+    }
+    return !atomic_load(&writer->failed);
+}
+
+int closeWriter(AsyncWriter *writer) {
+    atomic_store_explicit(&writer->closing, 1, memory_order_release);
+    pthread_join(writer->thread, NULL);
+    int ok = !atomic_load(&writer->failed);
+    if (fclose(writer->out) != 0) ok = 0;
+    free(writer->ring);
+    free(writer);
+    return ok;
+}
@@ -0,0 +1,76 @@
+// Writes output on a thread of its own, so the thread producing it never waits on I/O.
+// Created by Jackson Eshbaugh on 16.10.2026.
+//
+// The producer copies bytes into a lock-free single-producer/single-consumer ring; the
+// writer thread drains the ring into its file in large writes. The two only share the
+// ring's head and tail, each written by one side and read by the other. When the ring is
+// full, the producer either waits for room (WRITER_BLOCK) or drops what it was writing
+// and counts it (WRITER_DROP).
+
+#ifndef WRITER_H
+#define WRITER_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+
+#define WRITER_RING_SIZE (4 << 20) // bytes; a power of two
+#define WRITER_IDLE_NS 200000 // how long the writer sleeps when the ring is empty
+
+/**
+ * What putWriter() does when the ring has no room.
+ */
+typedef enum {
+    WRITER_BLOCK, // wait for the writer thread to make room
+    WRITER_DROP // drop the bytes, and count them
+} WriterPolicy;
+
+/**
+ * A file being written by a writer thread.
+ */
+typedef struct AsyncWriter {
+    FILE *out;
+    WriterPolicy policy;
+    unsigned char *ring;
+    _Atomic size_t head; // bytes ever put in the ring; only the producer writes it
+    _Atomic size_t tail; // bytes ever taken out; only the writer thread writes it
+    _Atomic size_t flushed; // bytes written and flushed to out
+    _Atomic int closing;
+    _Atomic int failed; // set if a write to out failed
+    unsigned long long dropped; // bytes dropped; only the producer touches it
+    pthread_t thread;
+} AsyncWriter;
+
+/**
+ * Starts a writer thread for a file.
+ * @param out the file to write to; the writer owns it from now on, and closes it
+ * @param policy what to do when the ring is full
+ * @return the writer, or NULL if it couldn't be allocated or started
+ */
+AsyncWriter *openWriter(FILE *out, WriterPolicy policy);
+
+/**
+ * Queues bytes to be written. Never waits on I/O; with WRITER_BLOCK it may wait for the
+ * writer thread to make room.
+ * @param writer the writer
+ * @param data the bytes
+ * @param length how many there are
+ * @return 1 if they were queued, 0 if they were dropped
+ */
+int putWriter(AsyncWriter *writer, const void *data, size_t length);
+
+/**
+ * Waits until everything queued so far has been written and flushed.
+ * @param writer the writer
+ * @return 1 if every write so far succeeded, 0 if one failed
+ */
+int syncWriter(AsyncWriter *writer);
+
+/**
+ * Writes out everything queued, stops the writer thread and closes the file.
+ * @param writer the writer
+ * @return 1 if every write succeeded, 0 if one failed
+ */
+int closeWriter(AsyncWriter *writer);
+
+#endif //WRITER_H